@@ -0,0 +1,193 @@
+#include "acia.h"
+
+#include <algorithm>
+
+namespace{
+    /**
+     * Baud rates selected by the low bits of the control register. 0 is the 16x external clock, which
+     * is 115200 baud with the usual 1.8432 MHz crystal
+     */
+    const double kBaudRates[16] = {115200, 50, 75, 109.92, 134.58, 150, 300, 600, 1200, 1800, 2400, 3600, 4800, 7200, 9600, 19200};
+}
+
+ACIA::ACIA(uint16_t base_address, EventScheduler *scheduler, InterruptController *interrupt_controller, const std::atomic<int> &clock_speed) : MemoryMappedDevice(base_address, kRegisterCount),
+                                                                                                                                                 scheduler{scheduler},
+                                                                                                                                                 interrupt_controller{interrupt_controller},
+                                                                                                                                                 clock_speed{clock_speed}{
+    irq_line = interrupt_controller -> allocateLine();
+    needs_sync = true;
+}
+
+ACIA::~ACIA(){
+    // Don't leave callbacks to us behind
+    if(receive_event_pending) scheduler -> cancel(receive_event);
+    if(transmit_event_pending) scheduler -> cancel(transmit_event);
+    interrupt_controller -> lowerIRQ(irq_line);
+}
+
+void ACIA::sync(uint64_t cycle){
+    current_cycle = cycle;
+}
+
+bool ACIA::attachHost(){
+    return !host_attached.exchange(true);
+}
+
+void ACIA::detachHost(){
+    host_attached = false;
+}
+
+ACIA::ByteRing *ACIA::getTransmitRing(){
+    return &transmit_ring;
+}
+
+ACIA::ByteRing *ACIA::getReceiveRing(){
+    return &receive_ring;
+}
+
+bool ACIA::setValue(uint16_t address, uint8_t value){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return false;
+
+    switch(relative_address){
+    case DATA:
+        // A character written while the last one is still going out replaces it
+        transmit_data = value;
+        status &= ~TRANSMITTER_EMPTY;
+        if(!transmit_event_pending){
+            uint64_t deadline = current_cycle + characterCycles();
+            transmit_event = scheduler -> schedule(deadline, [this, deadline](uint64_t){ transmitCharacter(deadline); });
+            transmit_event_pending = true;
+        }
+        break;
+    case STATUS:
+        // Programmed reset, clears the low bits of the command register
+        command &= 0xE0;
+        status &= ~OVERRUN;
+        updateReceiver();
+        break;
+    case COMMAND:
+        command = value;
+        updateReceiver();
+        break;
+    case CONTROL:
+        control = value;
+        break;
+    }
+    return true;
+}
+
+uint8_t ACIA::getValue(uint16_t address){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+
+    switch(relative_address){
+    case DATA:
+        status &= ~(RECEIVER_FULL | OVERRUN | PARITY_ERROR | FRAMING_ERROR);
+        return receive_data;
+    case STATUS:{
+        // Reading the status acknowledges the interrupt
+        uint8_t value = peekValue(address);
+        irq_pending = false;
+        updateIRQ();
+        return value;
+    }
+    }
+    return peekValue(address);
+}
+
+uint8_t ACIA::peekValue(uint16_t address){
+    size_t relative_address = address - this -> base_address;
+    switch(relative_address){
+    case DATA:
+        return receive_data;
+    case STATUS:
+        return status | (irq_pending ? IRQ_PENDING : 0);
+    case COMMAND:
+        return command;
+    case CONTROL:
+        return control;
+    }
+    return 0xFF;
+}
+
+uint64_t ACIA::characterCycles(){
+    // Start bit, data bits, parity bit and stop bits
+    int data_bits = 8 - ((control >> 5) & 0x03);
+    int parity_bits = (command & 0x20) ? 1 : 0;
+    int stop_bits = (control & 0x80) ? 2 : 1;
+    double bits = 1 + data_bits + parity_bits + stop_bits;
+    return std::max<uint64_t>(1, bits * clock_speed.load(std::memory_order_relaxed) / kBaudRates[control & 0x0F]);
+}
+
+void ACIA::checkHost(uint64_t cycle){
+    // The receiver keeps itself going while characters are coming in, so only an idle one needs starting
+    if(receive_event_pending || receive_ring.empty()) return;
+    sync(cycle);
+    updateReceiver();
+}
+
+void ACIA::updateReceiver(){
+    // DTR enables the receiver, there's only something to time while the host has sent us characters
+    bool enabled = command & 0x01;
+    if(enabled && !receive_event_pending && !receive_ring.empty()){
+        uint64_t deadline = current_cycle + characterCycles();
+        receive_event = scheduler -> schedule(deadline, [this, deadline](uint64_t){ receiveCharacter(deadline); });
+        receive_event_pending = true;
+    }else if(!enabled && receive_event_pending){
+        scheduler -> cancel(receive_event);
+        receive_event_pending = false;
+    }
+}
+
+void ACIA::receiveCharacter(uint64_t deadline){
+    receive_event_pending = false;
+
+    // Leave the character on the host side until the processor picked up the last one, so nothing
+    // typed or pasted is lost to an overrun
+    uint8_t character;
+    if(!(status & RECEIVER_FULL) && receive_ring.pop(character)){
+        receive_data = character;
+        status |= RECEIVER_FULL;
+        // IRD disables the receiver interrupt
+        if(!(command & 0x02)){
+            irq_pending = true;
+            updateIRQ();
+        }
+        // In echo mode whatever comes in goes straight back out
+        if((command & 0x10) && !(command & 0x0C)) transmit_ring.push(character);
+    }
+
+    // Look at the line again one character later, if there's anything more coming. Otherwise we're
+    // started again by checkHost() once there is
+    if(receive_ring.empty()) return;
+    uint64_t next_deadline = deadline + characterCycles();
+    receive_event = scheduler -> schedule(next_deadline, [this, next_deadline](uint64_t){ receiveCharacter(next_deadline); });
+    receive_event_pending = true;
+}
+
+void ACIA::transmitCharacter(uint64_t deadline){
+    transmit_event_pending = false;
+
+    // The transmitter is off while RTS is high, and waits if the host hasn't made room yet
+    bool transmitter_enabled = command & 0x0C;
+    if(!transmitter_enabled || !transmit_ring.push(transmit_data)){
+        uint64_t next_deadline = deadline + characterCycles();
+        transmit_event = scheduler -> schedule(next_deadline, [this, next_deadline](uint64_t){ transmitCharacter(next_deadline); });
+        transmit_event_pending = true;
+        return;
+    }
+
+    status |= TRANSMITTER_EMPTY;
+    // Only TIC = 01 enables the transmitter interrupt
+    if((command & 0x0C) == 0x04){
+        irq_pending = true;
+        updateIRQ();
+    }
+}
+
+void ACIA::updateIRQ(){
+    interrupt_controller -> setIRQ(irq_line, irq_pending);
+}
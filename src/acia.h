@@ -0,0 +1,188 @@
+#ifndef ACIA_H
+#define ACIA_H
+
+#include <atomic>
+
+#include "eventscheduler.h"
+#include "interruptcontroller.h"
+#include "memorymappeddevice.h"
+#include "spscring.h"
+
+/**
+ * A 6551 Asynchronous Communications Interface Adapter, the serial port
+ *
+ * The other end of the line is a pair of rings the host side (the serial console, stdin/stdout or a
+ * pseudo-terminal) reads and writes from its own thread. The processor's side never waits on them:
+ * characters take as long as the selected baud rate says, timed with scheduler events, and if the
+ * host falls behind the transmitter just stays busy until there's room. The receiver only has an
+ * event scheduled while characters are coming in, so an idle line doesn't cut the run slices short
+ *
+ * Not modelled: parity and framing errors, the modem control lines (DCD and DSR always read active)
+ * and the break character
+ */
+class ACIA : public MemoryMappedDevice{
+public:
+    /**
+     * The registers, relative to the base address
+     */
+    enum Register{
+        DATA = 0x0,
+        STATUS = 0x1, // Writing to it is a programmed reset
+        COMMAND = 0x2,
+        CONTROL = 0x3
+    };
+
+    /**
+     * Bits of the status register
+     */
+    enum StatusBit{
+        PARITY_ERROR = 0x01,
+        FRAMING_ERROR = 0x02,
+        OVERRUN = 0x04,
+        RECEIVER_FULL = 0x08,
+        TRANSMITTER_EMPTY = 0x10,
+        CARRIER_LOST = 0x20,
+        DATA_SET_NOT_READY = 0x40,
+        IRQ_PENDING = 0x80
+    };
+
+    /**
+     * Number of registers
+     */
+    constexpr static size_t kRegisterCount = 0x4;
+
+    /**
+     * How many characters the rings between the emulator and the host hold
+     */
+    constexpr static size_t kRingSize = 4096;
+
+    typedef SPSCRing<uint8_t, kRingSize> ByteRing;
+
+    /**
+     * @param base_address
+     * @param scheduler Where character timing events are scheduled
+     * @param interrupt_controller Where the IRQ output goes, the ACIA takes a line of its own
+     * @param clock_speed The processor clock the baud rates are converted with
+     */
+    ACIA(uint16_t base_address, EventScheduler *scheduler, InterruptController *interrupt_controller, const std::atomic<int> &clock_speed);
+    ~ACIA();
+
+    bool setValue(uint16_t address, uint8_t value) override;
+    uint8_t getValue(uint16_t address) override;
+    uint8_t peekValue(uint16_t address) override;
+    void sync(uint64_t cycle) override;
+
+    /**
+     * Claim the host side of the rings. There can only be one host, since each ring has one consumer
+     * and one producer
+     *
+     * @return false if something else already has it
+     */
+    bool attachHost();
+
+    /**
+     * Give up the host side of the rings
+     */
+    void detachHost();
+
+    /**
+     * Characters the processor sent, the host pops them
+     */
+    ByteRing *getTransmitRing();
+
+    /**
+     * Characters for the processor, the host pushes them
+     */
+    ByteRing *getReceiveRing();
+
+    /**
+     * Start receiving if the host pushed characters while the receiver was idle. The host can't
+     * schedule events itself, so the emulator calls this before each run slice
+     *
+     * @param cycle The current bus cycle
+     */
+    void checkHost(uint64_t cycle);
+
+private:
+    /**
+     * How many cycles a character takes on the line with the current settings
+     */
+    uint64_t characterCycles();
+
+    /**
+     * Start sampling the line for received characters if the receiver is enabled and the host sent
+     * some, stop if it isn't enabled
+     */
+    void updateReceiver();
+
+    /**
+     * A character time has passed on the receiver, pick up the next character if we have room for it.
+     * Goes on a character at a time until the host has nothing more
+     *
+     * @param deadline The cycle this was due on, the next one is timed from here
+     */
+    void receiveCharacter(uint64_t deadline);
+
+    /**
+     * A character time has passed on the transmitter, hand the character over to the host
+     *
+     * @param deadline The cycle this was due on
+     */
+    void transmitCharacter(uint64_t deadline);
+
+    /**
+     * Drive the IRQ line from irq_pending
+     */
+    void updateIRQ();
+
+    EventScheduler *scheduler;
+    InterruptController *interrupt_controller;
+    const std::atomic<int> &clock_speed;
+
+    /**
+     * Our line on the interrupt controller
+     */
+    unsigned irq_line;
+
+    /**
+     * The bus cycle we've been synced to
+     */
+    uint64_t current_cycle = 0;
+
+    uint8_t status = TRANSMITTER_EMPTY;
+    uint8_t command = 0x02;
+    uint8_t control = 0;
+
+    /**
+     * The last character received, and the one waiting to be sent
+     */
+    uint8_t receive_data = 0;
+    uint8_t transmit_data = 0;
+
+    /**
+     * Whether an interrupt condition happened since the status register was last read
+     */
+    bool irq_pending = false;
+
+    /**
+     * The next time the receiver looks at the line
+     */
+    EventScheduler::EventId receive_event = 0;
+    bool receive_event_pending = false;
+
+    /**
+     * When the character being sent is done
+     */
+    EventScheduler::EventId transmit_event = 0;
+    bool transmit_event_pending = false;
+
+    ByteRing transmit_ring;
+    ByteRing receive_ring;
+
+    /**
+     * Whether a host has claimed the rings
+     */
+    std::atomic<bool> host_attached = false;
+};
+
+#endif // ACIA_H
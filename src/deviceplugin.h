@@ -0,0 +1,146 @@
+#ifndef DEVICEPLUGIN_H
+#define DEVICEPLUGIN_H
+
+/**
+ * The interface between the emulator and device plugins
+ *
+ * A plugin is a shared library that exports EMULATOR_PLUGIN_CREATE_SYMBOL as an
+ * EmulatorPluginCreateFunction. It's plain C so plugins can be built with any compiler (or
+ * language) without having to match the emulator's C++ ABI, and it's the only header they need.
+ *
+ * A device either hands out plain memory, which the processor then reads and writes directly like
+ * RAM, or answers reads and writes through callbacks, which cost the same as a built-in device.
+ * Everything is called from the thread running the processor
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Bumped whenever the structs below change, a plugin should refuse versions it wasn't built for
+ */
+#define EMULATOR_PLUGIN_ABI_VERSION 1
+
+/**
+ * The name of the function the emulator looks up in the library
+ */
+#define EMULATOR_PLUGIN_CREATE_SYMBOL "emulator_plugin_create"
+
+/**
+ * Identifies a scheduled event so it can be cancelled
+ */
+typedef uint64_t EmulatorEventId;
+
+/**
+ * Called when a scheduled event fires, with the plugin's device and the bus cycle it fired on
+ */
+typedef void (*EmulatorEventCallback)(void *device, uint64_t cycle);
+
+/**
+ * What the emulator offers a device. Stays valid until the device is destroyed
+ */
+typedef struct EmulatorPluginHost{
+    /**
+     * Passed back as the first argument of the functions below
+     */
+    void *host;
+
+    /**
+     * How fast the processor runs, in Hz. Can change between runs
+     */
+    uint32_t (*get_clock_speed)(void *host);
+
+    /**
+     * Run a callback at a bus cycle, events in the past fire at the next instruction boundary
+     *
+     * @return The id of the event
+     */
+    EmulatorEventId (*schedule_event)(void *host, uint64_t cycle, EmulatorEventCallback callback, void *device);
+
+    /**
+     * Cancel an event that hasn't fired yet. Events still pending when the device is destroyed
+     * are cancelled for it
+     */
+    void (*cancel_event)(void *host, EmulatorEventId id);
+
+    /**
+     * Assert (non-zero) or release (zero) the device's IRQ line. It's level-triggered, release it once
+     * it's been serviced
+     */
+    void (*set_irq)(void *host, int asserted);
+
+    /**
+     * Assert or release the device's NMI line, the NMI fires when it's asserted
+     */
+    void (*set_nmi)(void *host, int asserted);
+} EmulatorPluginHost;
+
+/**
+ * A device, filled in by the plugin. Addresses passed to the callbacks are relative to the base
+ * address. Callbacks the device doesn't need are left NULL
+ */
+typedef struct EmulatorPluginDevice{
+    /**
+     * The plugin's state, passed back as the first argument of every callback
+     */
+    void *device;
+
+    /**
+     * Storage for the whole address range if the device is plain memory (no side effects on
+     * access), NULL to go through read and write instead. Has to stay valid until destroy
+     */
+    uint8_t *memory;
+
+    /**
+     * Non-zero if the processor can't write to memory, writes then go to write if there is one
+     */
+    int memory_read_only;
+
+    /**
+     * A read by the processor. Not used for memory
+     */
+    uint8_t (*read)(void *device, uint16_t address);
+
+    /**
+     * A write by the processor. Not used for memory, unless it's read only
+     */
+    void (*write)(void *device, uint16_t address, uint8_t value);
+
+    /**
+     * A read without side effects, to show the memory to the user. read is used if there isn't one
+     */
+    uint8_t (*peek)(void *device, uint16_t address);
+
+    /**
+     * Bring the device up to a bus cycle, called right before the processor accesses it
+     */
+    void (*sync)(void *device, uint64_t cycle);
+
+    /**
+     * Free the device
+     */
+    void (*destroy)(void *device);
+} EmulatorPluginDevice;
+
+/**
+ * Create a device
+ *
+ * @param abi_version EMULATOR_PLUGIN_ABI_VERSION of the emulator
+ * @param host
+ * @param base_address Where the device is on the bus
+ * @param length How many addresses it has
+ * @param options The device's options from the machine config, an empty string if there aren't any
+ * @param device To fill in
+ * @return 0 on success, anything else if the device can't be created
+ */
+typedef int (*EmulatorPluginCreateFunction)(unsigned abi_version, const EmulatorPluginHost *host, uint16_t base_address, size_t length, const char *options, EmulatorPluginDevice *device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEVICEPLUGIN_H
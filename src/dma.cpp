@@ -0,0 +1,92 @@
+#include "dma.h"
+
+#include <algorithm>
+
+#include "emulator.h"
+
+DMA::DMA(uint16_t base_address, Emulator *emulator, EventScheduler *scheduler, InterruptController *interrupt_controller) : MemoryMappedDevice(base_address, kRegisterCount),
+                                                                                                                            emulator{emulator},
+                                                                                                                            scheduler{scheduler},
+                                                                                                                            interrupt_controller{interrupt_controller}{
+    irq_line = interrupt_controller -> allocateLine();
+    registers[CYCLES_PER_BYTE] = kDefaultCyclesPerByte;
+    needs_sync = true;
+}
+
+DMA::~DMA(){
+    // Don't leave callbacks to us behind
+    if(transfer_event_pending) scheduler -> cancel(transfer_event);
+    interrupt_controller -> lowerIRQ(irq_line);
+}
+
+void DMA::sync(uint64_t cycle){
+    current_cycle = cycle;
+}
+
+bool DMA::setValue(uint16_t address, uint8_t value){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return false;
+
+    switch(relative_address){
+    case STATUS:
+        // Read only
+        break;
+    case CONTROL:
+        // START isn't kept, it only triggers
+        registers[CONTROL] = value & ~START;
+        updateIRQ();
+        if(value & START) startTransfer();
+        break;
+    default:
+        registers[relative_address] = value;
+    }
+    return true;
+}
+
+uint8_t DMA::getValue(uint16_t address){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+
+    if(relative_address == STATUS){
+        // Reading the status acknowledges the interrupt
+        uint8_t value = status;
+        status &= ~DONE;
+        updateIRQ();
+        return value;
+    }
+    return peekValue(address);
+}
+
+uint8_t DMA::peekValue(uint16_t address){
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+    if(relative_address == STATUS) return status;
+    return registers[relative_address];
+}
+
+void DMA::startTransfer(){
+    if(status & BUSY) return;
+    transfer_source = registers[SOURCE_LOW] | (registers[SOURCE_HIGH] << 8);
+    transfer_destination = registers[DESTINATION_LOW] | (registers[DESTINATION_HIGH] << 8);
+    transfer_length = registers[LENGTH_LOW] | (registers[LENGTH_HIGH] << 8);
+    status = (status & ~DONE) | BUSY;
+    updateIRQ();
+
+    // The copy itself is free, the time it would have taken is spent waiting for the event
+    uint64_t deadline = current_cycle + std::max<uint64_t>(1, (uint64_t) transfer_length * registers[CYCLES_PER_BYTE]);
+    transfer_event = scheduler -> schedule(deadline, [this](uint64_t){ finishTransfer(); });
+    transfer_event_pending = true;
+}
+
+void DMA::finishTransfer(){
+    transfer_event_pending = false;
+    emulator -> copyMemory(transfer_destination, transfer_source, transfer_length);
+    status = (status & ~BUSY) | DONE;
+    updateIRQ();
+}
+
+void DMA::updateIRQ(){
+    interrupt_controller -> setIRQ(irq_line, (status & DONE) && (registers[CONTROL] & IRQ_ENABLE));
+}
@@ -0,0 +1,123 @@
+#ifndef DMA_H
+#define DMA_H
+
+#include "eventscheduler.h"
+#include "interruptcontroller.h"
+#include "memorymappeddevice.h"
+
+class Emulator;
+
+/**
+ * A DMA controller, copies blocks of memory without the processor
+ *
+ * A transfer takes CYCLES_PER_BYTE bus cycles for every byte, timed with a scheduler event, while
+ * the processor carries on. When the time is up the block is copied all at once through
+ * Emulator::copyMemory(), so plain memory to plain memory is a single memcpy, and the controller
+ * reports that it's done, with an IRQ if it's enabled
+ */
+class DMA : public MemoryMappedDevice{
+public:
+    /**
+     * The registers, relative to the base address
+     */
+    enum Register{
+        SOURCE_LOW = 0x0,
+        SOURCE_HIGH = 0x1,
+        DESTINATION_LOW = 0x2,
+        DESTINATION_HIGH = 0x3,
+        LENGTH_LOW = 0x4, // In bytes, 0 copies nothing
+        LENGTH_HIGH = 0x5,
+        CYCLES_PER_BYTE = 0x6, // What a transfer costs in bus cycles, 0 finishes right away
+        CONTROL = 0x7, // Writing START begins a transfer with the registers as they are then
+        STATUS = 0x8 // Reading it acknowledges DONE and the interrupt
+    };
+
+    /**
+     * Bits of the control register
+     */
+    enum ControlBit{
+        START = 0x01,
+        IRQ_ENABLE = 0x02
+    };
+
+    /**
+     * Bits of the status register
+     */
+    enum StatusBit{
+        BUSY = 0x01,
+        DONE = 0x80
+    };
+
+    /**
+     * Number of registers
+     */
+    constexpr static size_t kRegisterCount = 0x10;
+
+    /**
+     * What a transfer costs per byte until the program says otherwise, about what a DMA controller
+     * stealing one bus cycle per byte would
+     */
+    constexpr static uint8_t kDefaultCyclesPerByte = 1;
+
+    /**
+     * @param base_address
+     * @param emulator Whose memory the transfers copy
+     * @param scheduler Where the ends of transfers are scheduled
+     * @param interrupt_controller Where the IRQ output goes, the controller takes a line of its own
+     */
+    DMA(uint16_t base_address, Emulator *emulator, EventScheduler *scheduler, InterruptController *interrupt_controller);
+    ~DMA();
+
+    bool setValue(uint16_t address, uint8_t value) override;
+    uint8_t getValue(uint16_t address) override;
+    uint8_t peekValue(uint16_t address) override;
+    void sync(uint64_t cycle) override;
+
+private:
+    /**
+     * Start a transfer with the current registers, unless one is already going
+     */
+    void startTransfer();
+
+    /**
+     * The transfer's time is up, copy the block and report it
+     */
+    void finishTransfer();
+
+    /**
+     * Drive the IRQ line from the status
+     */
+    void updateIRQ();
+
+    Emulator *emulator;
+    EventScheduler *scheduler;
+    InterruptController *interrupt_controller;
+
+    /**
+     * Our line on the interrupt controller
+     */
+    unsigned irq_line;
+
+    /**
+     * The bus cycle we've been synced to
+     */
+    uint64_t current_cycle = 0;
+
+    uint8_t registers[kRegisterCount] = {};
+    uint8_t status = 0;
+
+    /**
+     * The transfer in progress, as the registers were when it started
+     */
+    uint16_t transfer_source = 0;
+    uint16_t transfer_destination = 0;
+    size_t transfer_length = 0;
+
+    /**
+     * The end of the transfer in progress
+     */
+    EventScheduler::EventId transfer_event = 0;
+    bool transfer_event_pending = false;
+};
+
+#endif // DMA_H
@@ -2,36 +2,78 @@
 #include <QThread>
 
 #include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <fstream>
+#include <thread>
 
 #include "emulator.h"
 #include "mos6502.h"
 #include "log.h"
 #include "programram.h"
 #include "rom.h"
-
-Emulator::Emulator(){
-    // Allocate memory
-    this -> memory = new uint8_t[Emulator::kMemorySize];
-    memset(this -> memory, 0xff, Emulator::kMemorySize);
+#include "via.h"
+#include "dma.h"
+#include "mmu.h"
+#include "plugindevice.h"
+
+Emulator::Emulator(const MachineConfig &machine, CoreMode core_mode) : core_mode{core_mode}, program_offset{machine.program_offset}{
+    // Allocate memory, all of it in one arena that's sized up front
+    size_t arena_size = 0;
+    for(const DeviceConfig &device : machine.devices){
+        arena_size += device.getArenaSize();
+    }
+    this -> arena = new MemoryArena(arena_size);
 
     // Register to the helper functions
     EmulatorHelper::registerEmulator(this);
 
-    // Set up memory
-    ProgramRAM *program_RAM = new ProgramRAM(0x0000, 0x3fff);
-    addMemoryDevice(program_RAM);
-    ROM *program_ROM = new ROM(0x91ff, 0xffff - 0x91ff, 0xff);
-    addMemoryDevice(program_ROM);
+    // Devices schedule events and raise interrupts through these
+    this -> scheduler = new EventScheduler();
+    this -> interrupt_controller = new InterruptController();
+    this -> page_table = new PageTable();
 
-    // Instantiate cpu
-    this -> cpu = new mos6502(EmulatorHelper::busRead, EmulatorHelper::busWrite);
+    // Set up the devices the machine has, they go straight into the page table
+    for(const DeviceConfig &device : machine.devices){
+        addConfiguredDevice(device);
+    }
+
+    // Instantiate cpu, the cycle-stepped core counts bus cycles as it goes
+    if(core_mode == CYCLE_STEPPED){
+        this -> cpu = new mos6502(EmulatorHelper::busReadCycleStepped, EmulatorHelper::busWriteCycleStepped, EmulatorHelper::busFetchCycleStepped);
+    }else{
+        this -> cpu = new mos6502(EmulatorHelper::busRead, EmulatorHelper::busWrite, EmulatorHelper::busFetch);
+    }
+    // Let the processor sample the devices' interrupt lines
+    this -> cpu -> SetInterruptPending(interrupt_controller -> getPendingWord());
+    // So the halt reason can be sent from the worker thread
+    qRegisterMetaType<mos6502::HaltReason>("mos6502::HaltReason");
     // Reset the cpu
     this -> cpu -> Reset();
     is_running = false;
+
+    // Set up the live view buffer
+    this -> snapshot_buffer = new SnapshotBuffer();
+    this -> telemetry = new Telemetry();
+    previous_state = nullptr;
+
+    // Set up the worker on its own thread, it's reused for every run
+    worker_thread = new QThread();
+    worker = new ProcessorRunWorker(this);
+    worker -> moveToThread(worker_thread);
+    connect(this, &Emulator::startRunWorker, worker, &ProcessorRunWorker::runCPU);
+    worker_thread -> start(QThread::HighPriority);
 }
 
 Emulator::~Emulator(){
+    // Stop the worker and its thread
+    worker -> interrupt();
+    worker -> waitUntilStopped();
+    worker_thread -> quit();
+    worker_thread -> wait();
+    delete worker;
+    delete worker_thread;
+
     // Deregister from helper functions
     EmulatorHelper::deregisterEmulator();
 
@@ -40,20 +82,215 @@ Emulator::~Emulator(){
         delete memoryDevice.second;
     }
 
-    // Clean up memory
-    delete[] memory;
+    // Clean up memory, the devices' storage goes with the arena
+    delete arena;
     delete cpu;
+    delete snapshot_buffer;
+    delete telemetry;
+    delete scheduler;
+    delete page_table;
+    delete interrupt_controller;
 }
 
 mos6502 *Emulator::get6502(){
     return cpu;
 }
 
+Emulator::CoreMode Emulator::getCoreMode(){
+    return core_mode;
+}
+
+uint64_t Emulator::getBusCycle(){
+    return bus_cycle;
+}
+
+EventScheduler *Emulator::getScheduler(){
+    return scheduler;
+}
+
+InterruptController *Emulator::getInterruptController(){
+    return interrupt_controller;
+}
+
+uint16_t Emulator::getProgramOffset(){
+    return program_offset;
+}
+
+ACIA *Emulator::getSerialPort(){
+    return serial_port;
+}
+
+VRAM *Emulator::getVideo(){
+    return video;
+}
+
+SoundChip *Emulator::getSoundChip(){
+    return sound_chip;
+}
+
+Keyboard *Emulator::getKeyboard(){
+    return keyboard;
+}
+
+void Emulator::addConfiguredDevice(const DeviceConfig &device){
+    switch(device.type){
+    case DeviceConfig::RAM:{
+        ProgramRAM *ram = new ProgramRAM(device.base_address, device.length, arena);
+        size_t length;
+        loadBackingFile(device.file, ram -> getDirectMemory(device.base_address, length), device.length);
+        addMemoryDevice(ram, device.getAddressSpaceLength());
+        break;
+    }
+    case DeviceConfig::ROM:{
+        ROM *rom = new ROM(device.base_address, device.length, device.banks, arena);
+        // The file has the banks one after the other
+        for(size_t bank = 0; bank < device.banks; bank++){
+            if(!loadBackingFile(device.file, rom -> getBank(bank), device.length, bank * device.length)) break;
+        }
+        addMemoryDevice(rom, device.getAddressSpaceLength());
+        break;
+    }
+    case DeviceConfig::VIA:
+        addMemoryDevice(new VIA(device.base_address, scheduler, interrupt_controller), device.getAddressSpaceLength());
+        break;
+    case DeviceConfig::ACIA:
+        this -> serial_port = new ACIA(device.base_address, scheduler, interrupt_controller, clock_speed);
+        addMemoryDevice(serial_port, device.getAddressSpaceLength());
+        break;
+    case DeviceConfig::VIDEO:
+        this -> video = new VRAM(device.base_address);
+        addMemoryDevice(video, device.getAddressSpaceLength());
+        break;
+    case DeviceConfig::SOUND:
+        this -> sound_chip = new SoundChip(device.base_address);
+        addMemoryDevice(sound_chip, device.getAddressSpaceLength());
+        break;
+    case DeviceConfig::KEYBOARD:
+        this -> keyboard = new Keyboard(device.base_address, scheduler, interrupt_controller, clock_speed);
+        addMemoryDevice(keyboard, device.getAddressSpaceLength());
+        break;
+    case DeviceConfig::DMA:
+        addMemoryDevice(new DMA(device.base_address, this, scheduler, interrupt_controller), device.getAddressSpaceLength());
+        break;
+    case DeviceConfig::MMU:{
+        MMU *mmu = new MMU(device.base_address, device.ram_size, device.rom_size, arena);
+        loadBackingFile(device.file, mmu -> getROM(), mmu -> getROMSize());
+        addMemoryDevice(mmu, device.getAddressSpaceLength());
+        for(const DeviceConfig::Window &window : device.windows){
+            addMemoryDevice(mmu -> addWindow(window.base_address, window.size), window.size);
+        }
+        break;
+    }
+    case DeviceConfig::PLUGIN:{
+        QString error;
+        PluginDevice *plugin = PluginDevice::load(device.file, device.base_address, device.length, device.options,
+                                                  scheduler, interrupt_controller, clock_speed, error);
+        if(plugin == nullptr){
+            Log::Warning() << "Could not load the " << QString::fromStdString(device.name) << " plugin: " << error;
+            return;
+        }
+        addMemoryDevice(plugin, device.getAddressSpaceLength());
+        break;
+    }
+    }
+
+    // Restrict what the processor may do with the device's pages, for an MMU those are its windows
+    if(device.permissions == PageTable::ALL) return;
+    if(device.type == DeviceConfig::MMU){
+        for(const DeviceConfig::Window &window : device.windows){
+            page_table -> setPermissions(window.base_address, window.size, device.permissions);
+        }
+    }else{
+        page_table -> setPermissions(device.base_address, device.getAddressSpaceLength(), device.permissions);
+    }
+}
+
+bool Emulator::loadBackingFile(const std::string &path, uint8_t *memory, size_t length, size_t offset){
+    if(path.empty()) return false;
+    std::ifstream input_stream(path, std::ios::binary);
+    input_stream.seekg(offset);
+    if(!input_stream.read((char*) memory, length) && input_stream.gcount() == 0){
+        // Running off the end of the file part way through the banks isn't a problem
+        if(offset == 0) Log::Warning() << "Could not read " << QString::fromStdString(path) << ", leaving the memory blank";
+        return false;
+    }
+    return true;
+}
+
+MemoryMappedDevice *Emulator::getMemoryDevice(uint16_t address){
+    // Most pages belong to one device
+    MemoryMappedDevice *page_device = page_table -> entryFor(address).device;
+    if(page_device != nullptr) return page_device;
+    for(auto const &memoryDevice : this -> memory_devices){
+        if(memoryDevice.first.base_address <= address && memoryDevice.first.end_address >= address){
+            return memoryDevice.second;
+        }
+    }
+    return nullptr;
+}
+
+uint8_t Emulator::busReadValue(uint16_t address){
+    // Plain memory is read straight from its storage
+    const PageTable::Entry &entry = page_table -> entryFor(address);
+    if(entry.read_memory != nullptr) return entry.read_memory[address & PageTable::kOffsetMask];
+    // Pages that can't be read have no storage to read from, so they're only checked down here
+    if(!(entry.permissions & PageTable::READ)){
+        raiseProtectionFault(address, PageTable::READ);
+        return 0xFF;
+    }
+    return deviceReadValue(address);
+}
+
+void Emulator::busWriteValue(uint16_t address, uint8_t value){
+    const PageTable::Entry &entry = page_table -> entryFor(address);
+    if(entry.write_memory != nullptr){
+        entry.write_memory[address & PageTable::kOffsetMask] = value;
+    }else if(!(entry.permissions & PageTable::WRITE)){
+        raiseProtectionFault(address, PageTable::WRITE);
+        return;
+    }else{
+        deviceWriteValue(address, value);
+    }
+    if(!is_running) emit memoryChanged(address);
+}
+
+uint8_t Emulator::busFetchValue(uint16_t address){
+    const PageTable::Entry &entry = page_table -> entryFor(address);
+    if(entry.fetch_memory != nullptr) return entry.fetch_memory[address & PageTable::kOffsetMask];
+    if(!(entry.permissions & PageTable::EXECUTE)){
+        raiseProtectionFault(address, PageTable::EXECUTE);
+        return 0xEA; // NOP
+    }
+    return busReadValue(address);
+}
+
+uint8_t Emulator::deviceReadValue(uint16_t address){
+    MemoryMappedDevice *device = getMemoryDevice(address);
+    if(device == nullptr) return 0xFF;
+    // Devices that keep time catch up only when they're looked at
+    if(device -> needsSync()) device -> sync(bus_cycle);
+    return device -> getValue(address);
+}
+
+void Emulator::deviceWriteValue(uint16_t address, uint8_t value){
+    MemoryMappedDevice *device = getMemoryDevice(address);
+    if(device == nullptr) return;
+    if(device -> needsSync()) device -> sync(bus_cycle);
+    device -> setValue(address, value);
+}
+
+void Emulator::raiseProtectionFault(uint16_t address, PageTable::Permission access){
+    // Only the first fault of an instruction is reported
+    if(cpu -> IsHalted()) return;
+    protection_fault = {address, access};
+    cpu -> Trap(mos6502::PROTECTION_FAULT);
+}
+
 uint8_t Emulator::getMemoryValue(uint16_t address){
     // Find the memory device corresponding to the given address and get its value
     for(auto const &memoryDevice : this -> memory_devices){
         if(memoryDevice.first.base_address <= address && memoryDevice.first.end_address >= address){
-            return memoryDevice.second->getValue(address);
+            return memoryDevice.second->peekValue(address);
         }
     }
     return 0xFF; // Return -1 if the address is invalid
@@ -68,12 +305,51 @@ void Emulator::setMemoryValue(uint16_t address, uint8_t value){
     // Find the memory device corresponding to the given address and set its value
     for(auto const &memoryDevice : this -> memory_devices){
         if(memoryDevice.first.base_address <= address && memoryDevice.first.end_address >= address){
+            // Like a write from the processor, so timers and transfers it starts count from now
+            if(memoryDevice.second -> needsSync()) memoryDevice.second -> sync(bus_cycle);
             memoryDevice.second->setValue(address, value);
             if(!is_running) emit memoryChanged(address);
         }
     }
 }
 
+void Emulator::copyMemory(uint16_t destination, uint16_t source, size_t length){
+    while(length > 0){
+        // Never run past the end of the address space in one go
+        size_t chunk = std::min<size_t>(length, 0x10000 - std::max<size_t>(destination, source));
+
+        MemoryMappedDevice *source_device = getMemoryDevice(source);
+        MemoryMappedDevice *destination_device = getMemoryDevice(destination);
+        size_t source_length = 0;
+        size_t destination_length = 0;
+        uint8_t *source_memory = source_device == nullptr ? nullptr : source_device -> getDirectMemory(source, source_length);
+        uint8_t *destination_memory = destination_device == nullptr ? nullptr : destination_device -> getDirectMemory(destination, destination_length);
+
+        if(source_memory != nullptr && destination_memory != nullptr){
+            chunk = std::min({chunk, source_length, destination_length});
+            // A destination just ahead of the source repeats the bytes in between, like a byte at a time
+            // would. Compared by storage, since two MMU windows can show the same bank
+            uintptr_t source_start = (uintptr_t) source_memory;
+            uintptr_t destination_start = (uintptr_t) destination_memory;
+            if(destination_start > source_start && destination_start - source_start < chunk) chunk = destination_start - source_start;
+            // Behind the source, or anywhere else, moving it all at once is the same as ascending bytes
+            memmove(destination_memory, source_memory, chunk);
+            if(!is_running){
+                for(size_t offset = 0; offset < chunk; offset++) emit memoryChanged(destination + offset);
+            }
+        }else{
+            // Registers have to see every access. The page permissions only apply to the processor
+            chunk = 1;
+            deviceWriteValue(destination, deviceReadValue(source));
+            if(!is_running) emit memoryChanged(destination);
+        }
+
+        destination += chunk;
+        source += chunk;
+        length -= chunk;
+    }
+}
+
 int Emulator::step(){
     if(!is_running){
         // If we're not in run mode, run instruction and notify normally
@@ -88,9 +364,12 @@ int Emulator::step(){
         uint8_t S_before = cpu -> GetS();
         uint8_t X_before = cpu -> GetX();
         uint8_t Y_before = cpu -> GetY();
+        bool halted_before = cpu -> IsHalted();
 
-        uint64_t cycle_count = 0;
-        this -> cpu -> Run(1, cycle_count);
+        uint64_t cycle_count = runCycles(1);
+
+        // Report a halt the same way the run worker does, once when it happens
+        if(!halted_before && cpu -> IsHalted()) emit halted(cpu -> GetHaltPC(), cpu -> GetHaltReason());
 
         // See if the register values changed and notify if they have
         std::vector<Register> registers_to_update;
@@ -107,20 +386,84 @@ int Emulator::step(){
         Log::Info() << "Executed one instruction, " << cycle_count << " cycles";
         return cycle_count;
     } else {
-        // Otherwise, just step and return the cycle count
-        uint64_t cycle_count = 0;
-        this -> cpu -> Run(1, cycle_count);
-        return cycle_count;
+        // Otherwise the run worker owns the processor, the scheduler and the devices, leave them be
+        return 0;
     }
 
 
 
 }
 
+uint64_t Emulator::runCycles(int32_t cycles){
+    uint64_t cycle_count = 0;
+    // The host side of the serial port can't schedule events, so see if it sent anything
+    if(serial_port != nullptr) serial_port -> checkHost(bus_cycle);
+    // Fire whatever is already due
+    scheduler -> runDue(bus_cycle);
+    while(cycle_count < (uint64_t) cycles){
+        // Run up to the next event in one go, devices cost nothing in between
+        uint64_t deadline = std::min<uint64_t>(bus_cycle + (cycles - cycle_count), scheduler -> nextDeadline());
+        uint64_t start = bus_cycle;
+        if(core_mode == CYCLE_STEPPED){
+            // The bus counts the cycles itself as they happen
+            uint64_t core_cycle_count = 0;
+            this -> cpu -> RunCycleStepped(deadline - start, core_cycle_count);
+        }else{
+            // The core advances the clock after every instruction, so devices syncing see the current cycle
+            this -> cpu -> Run(deadline - start, bus_cycle);
+        }
+        uint64_t ran = bus_cycle - start;
+        // Nothing ran, the processor is halted
+        if(ran == 0) break;
+        cycle_count += ran;
+        scheduler -> runDue(bus_cycle);
+    }
+    return cycle_count;
+}
+
 void Emulator::resetCPU(){
+    // The worker owns the CPU while running, let it do the reset
+    if(is_running){
+        worker -> requestReset();
+        return;
+    }
     this -> cpu -> Reset();
 }
 
+QString Emulator::haltReasonToString(mos6502::HaltReason reason){
+    switch(reason){
+    case mos6502::HaltReason::ILLEGAL_OPCODE:
+        return "illegal opcode";
+    case mos6502::HaltReason::BREAK_TRAP:
+        return "BRK";
+    case mos6502::HaltReason::STOP_INSTRUCTION:
+        return "stop instruction";
+    case mos6502::HaltReason::PROTECTION_FAULT:
+        return "protection fault";
+    default:
+        return "not halted";
+    }
+}
+
+Emulator::ProtectionFault Emulator::getProtectionFault(){
+    return protection_fault;
+}
+
+QString Emulator::protectionFaultToString(const ProtectionFault &fault){
+    const char *access;
+    switch(fault.access){
+    case PageTable::READ:
+        access = "read from";
+        break;
+    case PageTable::WRITE:
+        access = "write to";
+        break;
+    default:
+        access = "execute at";
+    }
+    return QString::asprintf("%s $%04x", access, fault.address);
+}
+
 // The emulator instance registered
 // (Needed to be declared here to avoid double declaration)
 namespace EmulatorHelper{
@@ -136,64 +479,109 @@ void EmulatorHelper::deregisterEmulator(){
 }
 
 uint8_t EmulatorHelper::busRead(uint16_t address){
-    return emulator -> getMemoryValue(address);
+    return emulator -> busReadValue(address);
 }
 
 
 void EmulatorHelper::busWrite(uint16_t address, uint8_t value){
-    emulator -> setMemoryValue(address, value);
+    emulator -> busWriteValue(address, value);
+}
+
+uint8_t EmulatorHelper::busReadCycleStepped(uint16_t address){
+    emulator -> bus_cycle++;
+    return emulator -> busReadValue(address);
+}
+
+uint8_t EmulatorHelper::busFetch(uint16_t address){
+    return emulator -> busFetchValue(address);
+}
+
+uint8_t EmulatorHelper::busFetchCycleStepped(uint16_t address){
+    emulator -> bus_cycle++;
+    return emulator -> busFetchValue(address);
+}
+
+void EmulatorHelper::busWriteCycleStepped(uint16_t address, uint8_t value){
+    emulator -> bus_cycle++;
+    emulator -> busWriteValue(address, value);
 }
 
 void EmulatorHelper::replaceMemory(uint8_t *new_contents, size_t offset, size_t length){
-    memcpy((emulator -> memory) + offset, new_contents, length); // TODO: Remove
+    // Whatever doesn't fit below the end of the address space is dropped
+    if(offset >= Emulator::kMemorySize) return;
+    length = std::min(length, Emulator::kMemorySize - offset);
     // Set the memory contents in the given range from the given buffer
-    for(int offset_in_new_contents = 0; offset_in_new_contents < length; offset_in_new_contents++){
+    for(size_t offset_in_new_contents = 0; offset_in_new_contents < length; offset_in_new_contents++){
         emulator -> setMemoryValue(offset + offset_in_new_contents, new_contents[offset_in_new_contents]);
     }
 }
 
-Emulator::EmulatorState::EmulatorState(uint16_t PC, uint8_t S, uint8_t P, uint8_t A, uint8_t X, uint8_t Y, uint8_t *memory, size_t kMemorySize) : PC{PC}, S{S}, P{P}, A{A}, X{X}, Y{Y}, kMemorySize{kMemorySize}{
+Emulator::EmulatorState::EmulatorState(uint16_t PC, uint8_t S, uint8_t P, uint8_t A, uint8_t X, uint8_t Y, uint8_t *memory, size_t kMemorySize, PageTable *page_table) : PC{PC}, S{S}, P{P}, A{A}, X{X}, Y{Y}, kMemorySize{kMemorySize}{
     this -> memory = new uint8_t[kMemorySize];
     memcpy(this -> memory, memory, kMemorySize);
+    for(size_t page = 0; page < PageTable::kPageCount; page++){
+        page_memory[page] = page_table -> entryFor(page << PageTable::kPageBits).read_memory;
+    }
 }
 
 Emulator::EmulatorState::~EmulatorState(){
-    delete memory;
+    delete[] memory;
 }
 
 void Emulator::run(){
     if(is_running) return; // Can't run if we're already running
 
     // Save the current state so we can diff later
-    previous_state = new EmulatorState(cpu -> GetPC(), cpu -> GetS(), cpu -> GetP(), cpu -> GetA(), cpu -> GetX(), cpu -> GetY(), memory, kMemorySize);
+    previous_state = new EmulatorState(cpu -> GetPC(), cpu -> GetS(), cpu -> GetP(), cpu -> GetA(), cpu -> GetX(), cpu -> GetY(), arena -> getMemory(), arena -> getUsedSize(), page_table);
+
+    // Don't let the UI pick up a stale snapshot or statistics from the previous run
+    snapshot_buffer -> reset();
+    telemetry -> reset();
+
+    // Devices' changes would be queued from the worker, a program switching banks in a loop would flood
+    // the UI. The live view and the diff in interrupt() pick them up instead
+    for(auto const &memoryDevice : memory_devices){
+        memoryDevice.second -> blockSignals(true);
+    }
 
-    // Spawn new thread to run the CPU
-    worker_thread = new QThread();
-    // Create the worker object and set it up in the new thread
-    ProcessorRunWorker *worker = new ProcessorRunWorker(this);
-    worker -> moveToThread(worker_thread);
-    connect(this, &Emulator::startRunWorker, worker, &ProcessorRunWorker::runCPU);
-    connect(this, &Emulator::interruptRunWorker, worker, &ProcessorRunWorker::interrupt);
     // Start the worker
-    worker_thread -> start(QThread::HighPriority);
+    worker -> prepareToRun();
     emit startRunWorker();
     is_running = true;
+    emit runStateChanged(true);
 }
 
 void Emulator::interrupt(){
-    // Stop the worker
-    emit interruptRunWorker();
-    worker_thread -> terminate();
-    worker_thread -> wait();
+    if(!is_running) return; // Nothing to interrupt
+
+    // Ask the worker to stop, it finishes the instruction it's on and returns. Measure how long that takes
+    auto stop_requested_at = std::chrono::steady_clock().now();
+    worker -> interrupt();
+    worker -> waitUntilStopped();
+    telemetry -> publishStopLatency(std::chrono::steady_clock().now() - stop_requested_at);
+
     // We're no longer running, run() can be called again and changes should be updated the regular way
     is_running = false;
-    // The real clock speed is now 0
-    this -> real_clock_speed = 0;
-
-    // See if the memory has changed and notify what changed if it has
-    for(int addr = 0; addr < previous_state -> kMemorySize; addr++){
-        if(previous_state -> memory[addr] != memory[addr]){
-            emit memoryChanged((uint16_t) addr);
+    for(auto const &memoryDevice : memory_devices){
+        memoryDevice.second -> blockSignals(false);
+    }
+    emit runStateChanged(false);
+
+    // See if the memory has changed and notify what changed if it has. Pages of plain memory are
+    // compared with the copy of the arena a page at a time, devices' registers aren't tracked
+    for(size_t page = 0; page < PageTable::kPageCount; page++){
+        uint16_t page_address = page << PageTable::kPageBits;
+        const uint8_t *page_memory = page_table -> entryFor(page_address).read_memory;
+        if(page_memory != previous_state -> page_memory[page]){
+            // A different bank is showing, so anything could have changed
+            emit memoryRangeChanged(page_address, page_address + PageTable::kPageSize - 1);
+            continue;
+        }
+        if(!arena -> contains(page_memory)) continue;
+        const uint8_t *previous_memory = previous_state -> memory + (page_memory - arena -> getMemory());
+        if(memcmp(previous_memory, page_memory, PageTable::kPageSize) == 0) continue;
+        for(size_t offset = 0; offset < PageTable::kPageSize; offset++){
+            if(previous_memory[offset] != page_memory[offset]) emit memoryChanged(page_address + offset);
         }
     }
     // See if the register values changed and notify if they have
@@ -206,40 +594,227 @@ void Emulator::interrupt(){
     if(previous_state -> Y != cpu -> GetY()) registers_to_update.push_back(Register::Y);
 
     emit registersChanged(registers_to_update);
+
+    // The state is only needed until we've diffed against it
+    delete previous_state;
+    previous_state = nullptr;
+}
+
+bool Emulator::isRunning(){
+    return is_running;
+}
+
+SnapshotBuffer *Emulator::getSnapshotBuffer(){
+    return snapshot_buffer;
+}
+
+Telemetry *Emulator::getTelemetry(){
+    return telemetry;
+}
+
+void Emulator::captureSnapshot(MachineSnapshot *snapshot){
+    // Registers
+    snapshot -> PC = cpu -> GetPC();
+    snapshot -> S = cpu -> GetS();
+    snapshot -> P = cpu -> GetP();
+    snapshot -> A = cpu -> GetA();
+    snapshot -> X = cpu -> GetX();
+    snapshot -> Y = cpu -> GetY();
+    // Memory as the CPU sees it, plain memory a page at a time and everything else through the devices
+    for(size_t page_address = 0; page_address < MachineSnapshot::kMemorySize; page_address += PageTable::kPageSize){
+        const uint8_t *page_memory = page_table -> entryFor(page_address).read_memory;
+        if(page_memory != nullptr){
+            memcpy(snapshot -> memory + page_address, page_memory, PageTable::kPageSize);
+            continue;
+        }
+        for(size_t address = page_address; address < page_address + PageTable::kPageSize; address++){
+            snapshot -> memory[address] = getMemoryValue(address);
+        }
+    }
+    // The display, with what changed since the last capture
+    if(video != nullptr) video -> captureFrame(snapshot -> frame);
 }
 
 void ProcessorRunWorker::runCPU(){
-    should_run = true;
-    // If we should be running
-    while(should_run){
-        // This is how long one period should be
-        long long period_nanos = 1e9/(emulator->clock_speed);
-        // Run the processor by one instruction and measure the time and cycles
-        auto beginning = std::chrono::steady_clock().now();
-        int cycles = emulator -> step();
-        // Busy loop until we use up all the time we have for this instruction
-        while(std::chrono::duration_cast<chrono::nanoseconds>(std::chrono::steady_clock().now() - beginning).count() < (period_nanos * cycles)) asm("");
-        emulator -> real_clock_speed = ((double) 1e9 * (double) cycles)/((double) std::chrono::duration_cast<chrono::nanoseconds>(std::chrono::steady_clock().now() - beginning).count());
+    SnapshotBuffer *snapshot_buffer = emulator -> getSnapshotBuffer();
+    Telemetry *telemetry = emulator -> getTelemetry();
+    mos6502 *cpu = emulator -> get6502();
+    auto next_snapshot = std::chrono::steady_clock().now();
+    // Statistics are counted from the start of this run
+    uint64_t cycles_executed = 0;
+    uint64_t instructions_at_start = cpu -> GetInstructionCount();
+    uint64_t interrupts_at_start = cpu -> GetInterruptCount();
+
+    // The emulated clock is paced against the wall clock from this point on. Deadlines are always
+    // calculated from here rather than from the previous slice, so rounding and oversleeping don't accumulate
+    auto sync_time = std::chrono::steady_clock().now();
+    uint64_t cycles_since_sync = 0;
+    int synced_clock_speed = 0;
+    // What the last slice was trying to run at, for the final statistics
+    int target_clock_speed = 0;
+
+    // The most cycles a slice can run for and still take about kMaxSliceHostTime, adapted as we go.
+    // This is what bounds how long it takes us to notice a stop request
+    int32_t max_slice_cycles = kMinSliceCycles;
+
+    // Until we're asked to stop
+    while(!stop_requested.load(std::memory_order_relaxed)){
+        // Resets are done here so they never race with the CPU
+        if(reset_requested.exchange(false, std::memory_order_relaxed)){
+            cpu -> Reset();
+        }
+
+        // If the processor halted, tell the UI and park until we're reset or asked to stop instead of spinning
+        if(cpu -> IsHalted()){
+            emit emulator -> halted(cpu -> GetHaltPC(), cpu -> GetHaltReason());
+            // Publish what we got up to so the UI shows where the processor stopped
+            recordFinalStatistics(cycles_executed, instructions_at_start, interrupts_at_start, target_clock_speed);
+            if(emulator -> snapshot_rate > 0){
+                emulator -> captureSnapshot(snapshot_buffer -> getWriteBuffer());
+                snapshot_buffer -> publish();
+            }
+            {
+                std::unique_lock<std::mutex> lock(state_mutex);
+                state_changed.wait(lock, [this]{ return stop_requested.load(std::memory_order_relaxed) || reset_requested.load(std::memory_order_relaxed); });
+            }
+            // Pace from scratch once we're back
+            synced_clock_speed = 0;
+            continue;
+        }
+
+        bool turbo = emulator -> turbo.load(std::memory_order_relaxed);
+        int clock_speed = std::max(1, emulator -> clock_speed.load(std::memory_order_relaxed));
+
+        // Unthrottled, run as much as we can between two checks for a stop request. Otherwise one slice worth of cycles
+        int32_t slice_cycles = max_slice_cycles;
+        if(!turbo){
+            // If the target speed changed (or we were in turbo mode,) start pacing over at the new speed
+            if(clock_speed != synced_clock_speed){
+                sync_time = std::chrono::steady_clock().now();
+                cycles_since_sync = 0;
+                synced_clock_speed = clock_speed;
+            }
+            slice_cycles = std::min<int64_t>(max_slice_cycles, std::max<int64_t>(1, (int64_t) clock_speed * kSliceLength.count() / 1000000));
+        }
+
+        // Run the slice
+        auto slice_start = std::chrono::steady_clock().now();
+        uint64_t cycles = emulator -> runCycles(slice_cycles);
+        auto now = std::chrono::steady_clock().now();
+        cycles_executed += cycles;
+
+        // Grow or shrink the slice limit so a full slice takes about kMaxSliceHostTime
+        if(slice_cycles == max_slice_cycles){
+            auto slice_host_time = now - slice_start;
+            if(slice_host_time < kMaxSliceHostTime / 2) max_slice_cycles = std::min(max_slice_cycles * 2, kMaxSliceCycles);
+            else if(slice_host_time > kMaxSliceHostTime) max_slice_cycles = std::max(max_slice_cycles / 2, kMinSliceCycles);
+        }
+
+        if(turbo){
+            // Start pacing over when we go back to the throttled mode
+            synced_clock_speed = 0;
+        }else{
+            // Sleep until the wall clock catches up with the emulated clock, or until we're asked to stop
+            cycles_since_sync += cycles;
+            auto deadline = sync_time + std::chrono::nanoseconds(cycles_since_sync * 1000000000 / clock_speed);
+            if(now < deadline){
+                std::unique_lock<std::mutex> lock(state_mutex);
+                state_changed.wait_until(lock, deadline, [this]{ return stop_requested.load(std::memory_order_relaxed); });
+                now = std::chrono::steady_clock().now();
+            }else if(now - deadline > kMaxThrottleLag){
+                // We fell too far behind to catch up gracefully, start over from here
+                sync_time = now;
+                cycles_since_sync = 0;
+            }
+        }
+
+        // Publish a snapshot for the live view if it's time to. This never waits for the UI
+        if(emulator -> snapshot_rate > 0 && now >= next_snapshot){
+            emulator -> captureSnapshot(snapshot_buffer -> getWriteBuffer());
+            snapshot_buffer -> publish();
+            next_snapshot = now + std::chrono::nanoseconds((long long) (1e9 / emulator -> snapshot_rate));
+            // This is the first snapshot that shows the program's response to the last key it read
+            std::chrono::steady_clock::time_point pressed_at;
+            Keyboard *keyboard = emulator -> getKeyboard();
+            if(keyboard != nullptr && keyboard -> takeResponse(pressed_at)) telemetry -> recordInputLatency(now - pressed_at);
+        }
+
+        // Update the statistics, this only publishes every so often
+        target_clock_speed = turbo ? 0 : clock_speed;
+        telemetry -> record(now, cycles_executed,
+                            cpu -> GetInstructionCount() - instructions_at_start,
+                            cpu -> GetInterruptCount() - interrupts_at_start,
+                            target_clock_speed);
     }
+
+    // Publish the final statistics of the run
+    recordFinalStatistics(cycles_executed, instructions_at_start, interrupts_at_start, target_clock_speed);
+
+    // Let whoever asked us to stop know that we're done
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        is_active = false;
+    }
+    state_changed.notify_all();
+}
+
+void ProcessorRunWorker::recordFinalStatistics(uint64_t cycles_executed, uint64_t instructions_at_start, uint64_t interrupts_at_start, int target_clock_speed){
+    mos6502 *cpu = emulator -> get6502();
+    emulator -> getTelemetry() -> record(std::chrono::steady_clock().now(), cycles_executed,
+                                         cpu -> GetInstructionCount() - instructions_at_start,
+                                         cpu -> GetInterruptCount() - interrupts_at_start,
+                                         target_clock_speed, true);
+}
+
+void ProcessorRunWorker::prepareToRun(){
+    std::lock_guard<std::mutex> lock(state_mutex);
+    stop_requested = false;
+    reset_requested = false;
+    is_active = true;
 }
 
 void ProcessorRunWorker::interrupt(){
-    should_run = false;
+    // Set the flag under the lock so a worker about to sleep can't miss the wakeup
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stop_requested = true;
+    }
+    state_changed.notify_all();
+}
+
+void ProcessorRunWorker::requestReset(){
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        reset_requested = true;
+    }
+    state_changed.notify_all();
+}
+
+void ProcessorRunWorker::waitUntilStopped(){
+    std::unique_lock<std::mutex> lock(state_mutex);
+    state_changed.wait(lock, [this]{ return !is_active; });
 }
 
 ProcessorRunWorker::ProcessorRunWorker(Emulator *emulator) : emulator{emulator} {}
 
-void Emulator::addMemoryDevice(MemoryMappedDevice *device){
+void Emulator::addMemoryDevice(MemoryMappedDevice *device, size_t address_count){
     // Format correctly and add to the map
     this -> memory_devices[
             Emulator::AddressRange(device -> getBaseAddress(), // The base address
-                                   device -> getBaseAddress() + device -> getAddressSpaceLength() // The end address
+                                   device -> getBaseAddress() + address_count - 1 // The end address, inclusive
                                    )
             ] = device;
+    page_table -> setDevice(device -> getBaseAddress(), address_count, device);
+    device -> attachPageTable(page_table);
     connect(device, &MemoryMappedDevice::addressChanged, this, &Emulator::deviceMemoryChanged);
+    connect(device, &MemoryMappedDevice::addressRangeChanged, this, &Emulator::deviceMemoryRangeChanged);
 }
 
 
 void Emulator::deviceMemoryChanged(uint16_t address){
     emit memoryChanged(address);
 }
+
+void Emulator::deviceMemoryRangeChanged(uint16_t first, uint16_t last){
+    emit memoryRangeChanged(first, last);
+}
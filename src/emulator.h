@@ -4,9 +4,24 @@
 
 #include <vector>
 #include <map>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 
 #include "mos6502.h"
 #include "memorymappeddevice.h"
+#include "eventscheduler.h"
+#include "interruptcontroller.h"
+#include "pagetable.h"
+#include "memoryarena.h"
+#include "machineconfig.h"
+#include "acia.h"
+#include "vram.h"
+#include "soundchip.h"
+#include "keyboard.h"
+#include "snapshotbuffer.h"
+#include "telemetry.h"
 
 // Forward declaration of the emulator class
 class Emulator;
@@ -42,13 +57,47 @@ namespace EmulatorHelper{
      */
     uint8_t busRead(uint16_t address);
 
+    /**
+     * Memory - CPU interface for the cycle-stepped core, set
+     *
+     * Every access is one bus cycle, so this also advances the emulator's cycle counter
+     * @param address
+     * @param value
+     */
+    void busWriteCycleStepped(uint16_t address, uint8_t value);
+
+    /**
+     * Memory - CPU interface for the cycle-stepped core, get
+     *
+     * Every access is one bus cycle, so this also advances the emulator's cycle counter
+     * @param address
+     * @return
+     */
+    uint8_t busReadCycleStepped(uint16_t address);
+
+    /**
+     * Memory - CPU interface, opcode fetch
+     * @param address
+     * @return
+     */
+    uint8_t busFetch(uint16_t address);
+
+    /**
+     * Memory - CPU interface for the cycle-stepped core, opcode fetch
+     *
+     * Every access is one bus cycle, so this also advances the emulator's cycle counter
+     * @param address
+     * @return
+     */
+    uint8_t busFetchCycleStepped(uint16_t address);
+
     /**
      *
      * Replace contents of a new block with the contents of the provided buffer
      *
      * @param new_contents
      * @param offset Offset into the memory
-     * @param lenght Length of the buffer
+     * @param lenght Length of the buffer, anything past the end of the address space is left out
      */
     void replaceMemory(uint8_t *new_contents, size_t offset, size_t lenght);
 }
@@ -59,18 +108,109 @@ class ProcessorRunWorker : public QObject{
 public:
     ProcessorRunWorker(Emulator *emulator);
 
+    /**
+     * Run the processor until interrupt() is called
+     *
+     * Runs on the worker thread, prepareToRun() must be called before this is queued
+     */
     void runCPU();
+
+    /**
+     * Mark the worker as running, so waitUntilStopped() waits for the runCPU() call that's about to be queued
+     *
+     * Called from the UI thread before starting the worker
+     */
+    void prepareToRun();
+
+    /**
+     * Ask the worker to stop. Doesn't wait, can be called from any thread
+     *
+     * The worker checks between slices and wakes up from throttling sleeps immediately
+     */
     void interrupt();
 
     /**
-     * Whether the emulator should keep running
+     * Wait until runCPU() has returned
+     */
+    void waitUntilStopped();
+
+    /**
+     * Ask the worker to reset the processor between two slices. Doesn't wait, can be called from any thread
+     *
+     * Also wakes the worker up if it's parked on a halted processor
+     */
+    void requestReset();
+
+    /**
+     * How much emulated time the processor runs for between two checks of the wall clock
+     */
+    constexpr static std::chrono::microseconds kSliceLength{1000};
+
+    /**
+     * If the processor falls behind the wall clock by more than this (e.g. the host was busy,)
+     * the throttle starts over from the current time instead of running flat out to catch up
+     */
+    constexpr static std::chrono::milliseconds kMaxThrottleLag{50};
+
+    /**
+     * The throttle keeps the effective clock speed, as measured over the telemetry window,
+     * within this fraction of the target clock speed as long as the host can keep up
+     */
+    constexpr static double kThrottleTolerance = 0.01;
+
+    /**
+     * A slice never takes more host time than about this, so a stop request is noticed within it.
+     * The number of cycles per slice adapts to stay under it
+     */
+    constexpr static std::chrono::microseconds kMaxSliceHostTime{250};
+
+    /**
+     * Bounds for the number of cycles ran per slice
      */
-    bool should_run = true;
+    constexpr static int32_t kMinSliceCycles = 1000;
+    constexpr static int32_t kMaxSliceCycles = 100000000;
 
     /**
      * The emulator instance
      */
     Emulator *emulator;
+
+private:
+    /**
+     * Publish the statistics right away, e.g. when the run ends
+     *
+     * @param cycles_executed
+     * @param instructions_at_start
+     * @param interrupts_at_start
+     * @param target_clock_speed
+     */
+    void recordFinalStatistics(uint64_t cycles_executed, uint64_t instructions_at_start, uint64_t interrupts_at_start, int target_clock_speed);
+
+    /**
+     * Whether the worker has been asked to stop
+     *
+     * Written from the UI thread, read by the worker between slices
+     */
+    std::atomic<bool> stop_requested = false;
+
+    /**
+     * Whether the worker has been asked to reset the processor
+     *
+     * Written from the UI thread, read by the worker between slices
+     */
+    std::atomic<bool> reset_requested = false;
+
+    /**
+     * Whether runCPU() is queued or running, guarded by state_mutex
+     */
+    bool is_active = false;
+
+    /**
+     * Guards is_active, and lets stop and reset requests wake the worker up from throttling sleeps
+     * or while it's parked on a halted processor
+     */
+    std::mutex state_mutex;
+    std::condition_variable state_changed;
 };
 
 
@@ -79,7 +219,25 @@ class Emulator : public QObject{
     Q_OBJECT
 public:
 
-    Emulator();
+    /**
+     * How the processor is emulated
+     */
+    enum CoreMode{
+        /**
+         * Whole instructions at a time. This is the fast one
+         */
+        INSTRUCTION_STEPPED,
+        /**
+         * One bus cycle at a time, dummy accesses included, so devices see each access on the cycle it happens
+         */
+        CYCLE_STEPPED
+    };
+
+    /**
+     * @param machine The devices to build the machine from
+     * @param core_mode How the processor is emulated, fixed for the lifetime of the emulator
+     */
+    Emulator(const MachineConfig &machine, CoreMode core_mode = INSTRUCTION_STEPPED);
     ~Emulator();
 
     /**
@@ -87,8 +245,60 @@ public:
      */
     mos6502 *get6502();
 
+    /**
+     * Get how the processor is emulated
+     */
+    CoreMode getCoreMode();
+
+    /**
+     * Get the number of bus cycles since the emulator was created
+     *
+     * In the cycle-stepped mode this is the cycle of the bus access in progress, otherwise it's the cycle
+     * the instruction in progress started on. Only meaningful on the thread running the CPU
+     */
+    uint64_t getBusCycle();
+
+    /**
+     * Get the scheduler devices use to run code at a given bus cycle
+     *
+     * Only use from the thread running the CPU, or while the processor isn't running
+     */
+    EventScheduler *getScheduler();
+
+    /**
+     * Get the interrupt controller devices raise their interrupts through, safe to use from any thread
+     */
+    InterruptController *getInterruptController();
+
+    /**
+     * Get where assembled images are loaded, as set by the machine config
+     */
+    uint16_t getProgramOffset();
+
+    /**
+     * Get the serial port, its host side can be attached from any thread. nullptr if the machine doesn't have one
+     */
+    ACIA *getSerialPort();
+
+    /**
+     * Get the video device, nullptr if the machine doesn't have one
+     */
+    VRAM *getVideo();
+
+    /**
+     * Get the sound chip, nullptr if the machine doesn't have one
+     */
+    SoundChip *getSoundChip();
+
+    /**
+     * Get the keyboard, keys are pushed to it from the UI thread. nullptr if the machine doesn't have one
+     */
+    Keyboard *getKeyboard();
+
     /**
      * Get value from memory address
+     *
+     * Doesn't trigger the side effects of reading device registers, the processor's reads go through the bus
      * @param address
      * @return The value, 0xFF if the address is invalid
      */
@@ -96,22 +306,81 @@ public:
 
     /**
      * Set value at memory address
+     *
+     * Goes straight to the device, so only call it while the processor isn't running: devices schedule
+     * events and switch banks from their registers, which only the run worker may do while it runs
      * @param address
      * @param value
      */
     void setMemoryValue(uint16_t address, uint8_t value);
 
     /**
-     * @brief Step one instruction
-     * @return The number of cycles the instruction took
+     * Copy a block of memory over the bus, with the same result as copying it a byte at a time in
+     * ascending order (wrapping around at the end of the address space.) Where both ends are plain
+     * memory, runs of bytes are moved in one go instead of through the devices' registers
+     *
+     * Called by the DMA controller, from whichever thread owns the processor
+     * @param destination
+     * @param source
+     * @param length
+     */
+    void copyMemory(uint16_t destination, uint16_t source, size_t length);
+
+    /**
+     * @brief Step one instruction, only while not running
+     * @return The number of cycles the instruction took, 0 if the emulator is running
      */
     int step();
 
+    /**
+     * Run the processor for at least the given number of cycles, without notifying the UI
+     *
+     * Used by the run worker, runs whole instructions so it may overshoot by a few cycles. The processor
+     * is run up to the next scheduled event at a time, and the event is fired before going on. Characters
+     * the host sent the serial port since the last call are picked up here
+     *
+     * @param cycles
+     * @return The number of cycles actually ran
+     */
+    uint64_t runCycles(int32_t cycles);
+
     /**
      * Reset the CPU
+     *
+     * If the processor is running, the reset is handed to the run worker and happens between two slices.
+     * This also resumes a halted processor
      */
     void resetCPU();
 
+    /**
+     * Get a human readable description of why the processor halted
+     *
+     * @param reason
+     * @return The description
+     */
+    static QString haltReasonToString(mos6502::HaltReason reason);
+
+    /**
+     * An access by the processor that its page's permissions don't allow
+     */
+    struct ProtectionFault{
+        uint16_t address;
+        PageTable::Permission access;
+    };
+
+    /**
+     * Get the access that halted the processor, if it halted with mos6502::PROTECTION_FAULT
+     */
+    ProtectionFault getProtectionFault();
+
+    /**
+     * Get a human readable description of a protection fault, e.g. "write to $9300"
+     *
+     * @param fault
+     * @return The description
+     */
+    static QString protectionFaultToString(const ProtectionFault &fault);
+
     //#define lowerMemory
 
     #ifdef lowerMemory
@@ -121,23 +390,34 @@ public:
     // Memory size
     constexpr static size_t kMemorySize = 0x10000;
     #endif
-    constexpr static size_t kProgMemOffset = 0x5f00;
 
     /**
      * The CPU will attempt to run at this speed
+     *
+     * Written from the UI thread, read by the run worker once per slice
+     */
+    std::atomic<int> clock_speed = 1000000;
+
+    /**
+     * If set, the CPU runs as fast as the host allows and `clock_speed` is ignored
+     *
+     * Written from the UI thread, read by the run worker once per slice
      */
-    int clock_speed = 1000000;
+    std::atomic<bool> turbo = false;
 
     /**
-     * The actual speed the CPU is running at
+     * How many times per second a snapshot of the machine is published for the UI while running
+     *
+     * 0 disables the live view
      */
-    double real_clock_speed = 0;
+    int snapshot_rate = 30;
 
     /**
      * The state of the emulator can be stored in this class. It will remember the registers and the entire memory
+     * (the whole memory arena, so banks that aren't mapped too), and which storage each page was showing
      */
     struct EmulatorState{
-        EmulatorState(uint16_t PC, uint8_t S, uint8_t P, uint8_t A, uint8_t X, uint8_t Y, uint8_t *memory, size_t kMemorySize);
+        EmulatorState(uint16_t PC, uint8_t S, uint8_t P, uint8_t A, uint8_t X, uint8_t Y, uint8_t *memory, size_t kMemorySize, PageTable *page_table);
         ~EmulatorState();
         uint16_t PC;
         uint8_t S;
@@ -147,6 +427,7 @@ public:
         uint8_t Y;
         uint8_t *memory;
         size_t kMemorySize;
+        const uint8_t *page_memory[PageTable::kPageCount];
     };
 
     /**
@@ -159,6 +440,30 @@ public:
      */
     void interrupt();
 
+    /**
+     * Whether the processor is in the run state
+     */
+    bool isRunning();
+
+    /**
+     * Get the buffer the run worker publishes its snapshots to
+     */
+    SnapshotBuffer *getSnapshotBuffer();
+
+    /**
+     * Get the run-time statistics published by the run worker
+     */
+    Telemetry *getTelemetry();
+
+    /**
+     * Copy the registers and the entire memory into the given snapshot
+     *
+     * Must be called from the thread running the CPU, between instructions
+     *
+     * @param snapshot
+     */
+    void captureSnapshot(MachineSnapshot *snapshot);
+
     /**
      * Registers for the CPU
      */
@@ -202,6 +507,13 @@ public:
      */
     void deviceMemoryChanged(uint16_t address);
 
+    /**
+     * Slot for when a whole range of a device's memory changes at once, e.g. on a bank switch
+     *
+     * Emits memoryRangeChanged with the same parameters
+     */
+    void deviceMemoryRangeChanged(uint16_t first, uint16_t last);
+
 signals:
     /**
      * Notify that the memory changed at given address
@@ -210,6 +522,14 @@ signals:
      */
     void memoryChanged(uint16_t address);
 
+    /**
+     * Notify that the memory from `first` to `last` (inclusive) changed
+     *
+     * @param first
+     * @param last
+     */
+    void memoryRangeChanged(uint16_t first, uint16_t last);
+
     /**
      * Notify that an instruction was ran
      */
@@ -223,14 +543,28 @@ signals:
     void registersChanged(std::vector<Register> registers_to_update);
 
     /**
-     * Used to start the RunWorker
+     * Notify that the processor halted (e.g. on an illegal opcode) while running or stepping
+     *
+     * The run worker stays parked without using the host CPU until the processor is reset or interrupted.
+     * Emitted from the worker thread while running, and from step() otherwise
+     *
+     * @param pc The address of the instruction that halted the processor
+     * @param reason
      */
-    void startRunWorker();
+    void halted(uint16_t pc, mos6502::HaltReason reason);
 
     /**
-     * Request to stop the RunWorker
+     * Notify that the processor entered or left the run state
+     *
+     * @param is_running
+     */
+    void runStateChanged(bool is_running);
+
+    /**
+     * Used to start the RunWorker
      */
-    void interruptRunWorker();
+    void startRunWorker();
+
 
 private:
     /**
@@ -239,11 +573,55 @@ private:
     mos6502 *cpu;
 
     /**
-     * The memory array
-     *
-     * TODO: Remove
+     * How the processor is emulated
      */
-    uint8_t *memory;
+    const CoreMode core_mode;
+
+    /**
+     * Where assembled images are loaded
+     */
+    const uint16_t program_offset;
+
+    /**
+     * Bus cycles since the emulator was created
+     */
+    uint64_t bus_cycle = 0;
+
+    /**
+     * Events scheduled by devices, run by runCycles()
+     */
+    EventScheduler *scheduler;
+
+    /**
+     * The interrupt lines of the devices, sampled by the processor between instructions
+     */
+    InterruptController *interrupt_controller;
+
+    /**
+     * The serial port, also in memory_devices
+     */
+    ACIA *serial_port = nullptr;
+
+    /**
+     * The video device, also in memory_devices
+     */
+    VRAM *video = nullptr;
+
+    /**
+     * The sound chip, also in memory_devices
+     */
+    SoundChip *sound_chip = nullptr;
+
+    /**
+     * The keyboard, also in memory_devices
+     */
+    Keyboard *keyboard = nullptr;
+
+    /**
+     * Where the storage of every device that's plain memory comes from, so the whole machine's
+     * memory is one block
+     */
+    MemoryArena *arena;
 
     /**
      * If the emulator is currently in the run state
@@ -259,10 +637,25 @@ private:
     EmulatorState *previous_state;
 
     /**
-     * The worker thread
+     * Snapshots published by the run worker for the UI
+     */
+    SnapshotBuffer *snapshot_buffer;
+
+    /**
+     * Run-time statistics published by the run worker
+     */
+    Telemetry *telemetry;
+
+    /**
+     * The worker thread, kept around across runs
      */
     QThread *worker_thread;
 
+    /**
+     * The worker running the CPU on worker_thread
+     */
+    ProcessorRunWorker *worker;
+
     /**
      * A map of all the memory devices we know of
      * The key is the `AddressRange` of the device, and the value is the
@@ -270,15 +663,96 @@ private:
      */
     std::map<AddressRange, MemoryMappedDevice*> memory_devices;
 
+    /**
+     * How the bus gets to each page without searching memory_devices, filled in as devices are added
+     */
+    PageTable *page_table;
+
     /**
      * Adds a memory mapped device to the emulator
      * @param device
+     * @param address_count How many addresses it takes up from its base address
+     */
+    void addMemoryDevice(MemoryMappedDevice *device, size_t address_count);
+
+    /**
+     * Create a device from its description in the machine config and add it
+     * @param device
+     */
+    void addConfiguredDevice(const DeviceConfig &device);
+
+    /**
+     * Fill memory from a file
+     * @param path The file, nothing is loaded if it's empty
+     * @param memory
+     * @param length How much to read
+     * @param offset Where in the file to start reading
+     * @return false if there was nothing to read
+     */
+    bool loadBackingFile(const std::string &path, uint8_t *memory, size_t length, size_t offset = 0);
+
+    /**
+     * Find the device mapped at an address
+     * @param address
+     * @return The device, nullptr if there's nothing there
+     */
+    MemoryMappedDevice *getMemoryDevice(uint16_t address);
+
+    /**
+     * Read on behalf of the processor, letting the device catch up to the current cycle first
+     * @param address
+     * @return The value, 0xFF if the address is invalid or can't be read
+     */
+    uint8_t busReadValue(uint16_t address);
+
+    /**
+     * Write on behalf of the processor, letting the device catch up to the current cycle first
+     * @param address
+     * @param value
+     */
+    void busWriteValue(uint16_t address, uint8_t value);
+
+    /**
+     * Fetch an opcode on behalf of the processor
+     * @param address
+     * @return The opcode, a NOP if the address can't be executed so nothing of the instruction runs
+     */
+    uint8_t busFetchValue(uint16_t address);
+
+    /**
+     * Read through the device at an address, regardless of the page's permissions
+     * @param address
+     * @return The value, 0xFF if the address is invalid
+     */
+    uint8_t deviceReadValue(uint16_t address);
+
+    /**
+     * Write through the device at an address, regardless of the page's permissions
+     * @param address
+     * @param value
+     */
+    void deviceWriteValue(uint16_t address, uint8_t value);
+
+    /**
+     * Halt the processor at the end of the instruction in progress, for an access the page's
+     * permissions don't allow
+     * @param address
+     * @param access
+     */
+    void raiseProtectionFault(uint16_t address, PageTable::Permission access);
+
+    /**
+     * The last protection fault, written by the thread running the processor before it reports the halt
      */
-    void addMemoryDevice(MemoryMappedDevice *device);
+    ProtectionFault protection_fault = {0, PageTable::READ};
 
     friend void EmulatorHelper::registerEmulator(Emulator *emulator);
     friend void EmulatorHelper::deregisterEmulator();;
     friend void EmulatorHelper::busWrite(uint16_t address, uint8_t value);
     friend uint8_t EmulatorHelper::busRead(uint16_t address);
+    friend void EmulatorHelper::busWriteCycleStepped(uint16_t address, uint8_t value);
+    friend uint8_t EmulatorHelper::busReadCycleStepped(uint16_t address);
+    friend uint8_t EmulatorHelper::busFetch(uint16_t address);
+    friend uint8_t EmulatorHelper::busFetchCycleStepped(uint16_t address);
     friend void EmulatorHelper::replaceMemory(uint8_t *newContents, size_t offset, size_t length);
 };
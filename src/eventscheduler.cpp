@@ -0,0 +1,52 @@
+#include "eventscheduler.h"
+
+#include <algorithm>
+
+EventScheduler::EventId EventScheduler::schedule(uint64_t cycle, Callback callback){
+    EventId id = next_id++;
+    events.push_back(Event{cycle, id, std::move(callback)});
+    std::push_heap(events.begin(), events.end());
+    return id;
+}
+
+void EventScheduler::cancel(EventId id){
+    // Events that already fired or were never scheduled are ignored
+    if(id >= next_id) return;
+    for(const Event &event : events){
+        if(event.id == id){
+            cancelled.insert(id);
+            discardCancelled();
+            return;
+        }
+    }
+}
+
+uint64_t EventScheduler::nextDeadline(){
+    return events.empty() ? kNoDeadline : events.front().cycle;
+}
+
+void EventScheduler::runDue(uint64_t cycle){
+    while(!events.empty() && events.front().cycle <= cycle){
+        // Take the event out before running it, the callback may schedule more
+        std::pop_heap(events.begin(), events.end());
+        Event event = std::move(events.back());
+        events.pop_back();
+        event.callback(cycle);
+        discardCancelled();
+    }
+}
+
+void EventScheduler::clear(){
+    events.clear();
+    cancelled.clear();
+}
+
+void EventScheduler::discardCancelled(){
+    while(!events.empty() && !cancelled.empty()){
+        auto found = cancelled.find(events.front().id);
+        if(found == cancelled.end()) return;
+        cancelled.erase(found);
+        std::pop_heap(events.begin(), events.end());
+        events.pop_back();
+    }
+}
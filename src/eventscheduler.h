@@ -0,0 +1,114 @@
+#ifndef EVENTSCHEDULER_H
+#define EVENTSCHEDULER_H
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Runs callbacks at given bus cycles, so devices only do work when something actually happens
+ * (a timer expiring, a byte arriving, a video line ending) instead of being polled
+ *
+ * Events are kept in a min-heap ordered by their deadline, the run loop asks for the next deadline
+ * and runs the processor up to it in one go. Events fire at the first instruction boundary at or
+ * after their deadline, the cycle they fire on is passed to the callback so devices can account for
+ * the difference
+ *
+ * Not thread safe, only use from the thread running the processor (or while it's not running)
+ */
+class EventScheduler{
+public:
+    /**
+     * Identifies a scheduled event so it can be cancelled
+     */
+    typedef uint64_t EventId;
+
+    /**
+     * Called with the bus cycle the event fired on
+     */
+    typedef std::function<void(uint64_t cycle)> Callback;
+
+    /**
+     * Returned by nextDeadline() when nothing is scheduled
+     */
+    constexpr static uint64_t kNoDeadline = std::numeric_limits<uint64_t>::max();
+
+    /**
+     * Schedule a callback
+     *
+     * @param cycle The bus cycle to run the callback at, events in the past fire at the next boundary
+     * @param callback
+     * @return The id of the event
+     */
+    EventId schedule(uint64_t cycle, Callback callback);
+
+    /**
+     * Cancel an event that hasn't fired yet
+     *
+     * @param id
+     */
+    void cancel(EventId id);
+
+    /**
+     * Get the deadline of the earliest event
+     *
+     * @return The bus cycle, kNoDeadline if nothing is scheduled
+     */
+    uint64_t nextDeadline();
+
+    /**
+     * Run the callbacks of every event due at the given cycle, earliest first
+     *
+     * Callbacks may schedule new events, those fire in the same call if they're already due
+     *
+     * @param cycle The current bus cycle
+     */
+    void runDue(uint64_t cycle);
+
+    /**
+     * Drop every scheduled event
+     */
+    void clear();
+
+private:
+    /**
+     * A scheduled callback
+     */
+    struct Event{
+        uint64_t cycle;
+        EventId id;
+        Callback callback;
+
+        /**
+         * Reversed so the heap keeps the earliest event on top, events with the same deadline fire
+         * in the order they were scheduled
+         */
+        bool operator<(const Event &rhs) const{
+            return cycle != rhs.cycle ? cycle > rhs.cycle : id > rhs.id;
+        }
+    };
+
+    /**
+     * Drop cancelled events from the top of the heap
+     */
+    void discardCancelled();
+
+    /**
+     * The events, as a heap
+     */
+    std::vector<Event> events;
+
+    /**
+     * Events cancelled but still in the heap, they're dropped once they reach the top
+     */
+    std::unordered_set<EventId> cancelled;
+
+    /**
+     * The id the next event will get
+     */
+    EventId next_id = 0;
+};
+
+#endif // EVENTSCHEDULER_H
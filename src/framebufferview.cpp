@@ -0,0 +1,71 @@
+#include "framebufferview.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+
+#include <algorithm>
+
+FramebufferView::FramebufferView(Emulator *emulator, QWidget *parent) : QWidget(parent),
+                                                                        emulator{emulator},
+                                                                        image(FrameSnapshot::kWidth, FrameSnapshot::kHeight, QImage::Format_RGB32){
+    image.fill(Qt::black);
+
+    // Memory changes while stopped (stepping, editing, loading) are picked up on the next refresh
+    connect(emulator, &Emulator::memoryChanged, this, &FramebufferView::markStale);
+    connect(emulator, &Emulator::memoryRangeChanged, this, &FramebufferView::markStale);
+    connect(emulator, &Emulator::runStateChanged, this, &FramebufferView::markStale);
+}
+
+void FramebufferView::markStale(){
+    stale = true;
+}
+
+void FramebufferView::refresh(){
+    // While running, the frames come with the live view snapshots
+    if(!stale || emulator -> isRunning() || emulator -> getVideo() == nullptr) return;
+    stale = false;
+    emulator -> getVideo() -> captureFrame(stopped_frame);
+    applyFrame(stopped_frame);
+}
+
+void FramebufferView::applyFrame(const FrameSnapshot &frame){
+    // Older than what we already have
+    if(frame.generation <= drawn_generation) return;
+
+    QRect target = imageRect();
+    double scale = (double) target.width() / FrameSnapshot::kWidth;
+    for(int row = 0; row < FrameSnapshot::kRows; row++){
+        // Redraw the changed tiles, repaint the span of the row they cover
+        int first_column = -1;
+        int last_column = -1;
+        for(int column = 0; column < FrameSnapshot::kColumns; column++){
+            int tile = row * FrameSnapshot::kColumns + column;
+            if(frame.tile_generation[tile] <= drawn_generation) continue;
+            glyph_renderer.drawTile(frame, tile, (uint32_t*) image.bits(), image.bytesPerLine() / sizeof(uint32_t));
+            if(first_column < 0) first_column = column;
+            last_column = column;
+        }
+        if(first_column < 0) continue;
+        QRectF changed(first_column * FrameSnapshot::kTileSize, row * FrameSnapshot::kTileSize,
+                       (last_column - first_column + 1) * FrameSnapshot::kTileSize, FrameSnapshot::kTileSize);
+        update(QRectF(target.topLeft() + changed.topLeft() * scale, changed.size() * scale).toAlignedRect());
+    }
+    drawn_generation = frame.generation;
+}
+
+QRect FramebufferView::imageRect() const{
+    // Integer scaling keeps the pixels square and sharp, unless the widget is smaller than the screen
+    int scale = std::max(1, std::min(width() / FrameSnapshot::kWidth, height() / FrameSnapshot::kHeight));
+    QSize size(FrameSnapshot::kWidth * scale, FrameSnapshot::kHeight * scale);
+    return QRect(QPoint((width() - size.width()) / 2, (height() - size.height()) / 2), size);
+}
+
+QSize FramebufferView::sizeHint() const{
+    return QSize(FrameSnapshot::kWidth * 2, FrameSnapshot::kHeight * 2);
+}
+
+void FramebufferView::paintEvent(QPaintEvent *event){
+    QPainter painter(this);
+    painter.fillRect(event -> rect(), Qt::black);
+    painter.drawImage(imageRect(), image);
+}
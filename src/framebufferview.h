@@ -0,0 +1,79 @@
+#ifndef FRAMEBUFFERVIEW_H
+#define FRAMEBUFFERVIEW_H
+
+#include <QImage>
+#include <QWidget>
+
+#include "emulator.h"
+#include "glyphrenderer.h"
+
+/**
+ * Shows the framebuffer of the video device
+ *
+ * The picture is kept in a QImage and only the tiles that changed since the last frame are redrawn
+ * into it, by a GlyphRenderer. All of it happens on the UI thread, from snapshots: while the processor runs the frames
+ * come with the live view snapshots, while it's stopped the view captures one itself when memory
+ * changes
+ */
+class FramebufferView : public QWidget{
+    Q_OBJECT
+public:
+    explicit FramebufferView(Emulator *emulator, QWidget *parent = nullptr);
+
+    /**
+     * Redraw the tiles that changed since the last frame we drew
+     *
+     * @param frame
+     */
+    void applyFrame(const FrameSnapshot &frame);
+
+    /**
+     * Capture and draw a frame if memory changed while the processor is stopped
+     */
+    void refresh();
+
+    /**
+     * Remember that the picture may be out of date
+     */
+    void markStale();
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    /**
+     * Where the image is drawn in the widget, as large as fits while keeping the aspect ratio
+     */
+    QRect imageRect() const;
+
+    Emulator *emulator;
+
+    /**
+     * The picture, kWidth x kHeight
+     */
+    QImage image;
+
+    /**
+     * Turns the tiles into pixels, with the fastest instructions we have
+     */
+    GlyphRenderer glyph_renderer;
+
+    /**
+     * The generation of the last frame we drew, 0 before the first one
+     */
+    uint64_t drawn_generation = 0;
+
+    /**
+     * Whether memory changed while stopped since we last captured a frame
+     */
+    bool stale = true;
+
+    /**
+     * Frame captured by the view itself while stopped
+     */
+    FrameSnapshot stopped_frame;
+};
+
+#endif // FRAMEBUFFERVIEW_H
@@ -0,0 +1,94 @@
+#include "framerecorder.h"
+
+#include <chrono>
+
+FrameRecorder::FrameRecorder(VRAM *video, EventScheduler *scheduler, uint64_t interval_cycles, Format format) : video{video},
+                                                                                                               scheduler{scheduler},
+                                                                                                               interval_cycles{interval_cycles > 0 ? interval_cycles : 1},
+                                                                                                               format{format}{
+    // Every slot starts out free
+    for(uint8_t slot = 0; slot < kQueueLength; slot++) free_slots.push(slot);
+}
+
+FrameRecorder::~FrameRecorder(){
+    stop();
+}
+
+bool FrameRecorder::start(std::string path, uint64_t start_cycle){
+    output = fopen(path.c_str(), "wb");
+    if(output == nullptr) return false;
+
+    stopping = false;
+    writer = std::thread(&FrameRecorder::writeFrames, this);
+
+    uint64_t deadline = start_cycle + interval_cycles;
+    capture_event = scheduler -> schedule(deadline, [this, deadline](uint64_t){ captureFrame(deadline); });
+    capture_event_pending = true;
+    return true;
+}
+
+void FrameRecorder::stop(){
+    if(capture_event_pending) scheduler -> cancel(capture_event);
+    capture_event_pending = false;
+
+    // The writer empties the queue before it finishes
+    stopping = true;
+    if(writer.joinable()) writer.join();
+
+    if(output != nullptr) fclose(output);
+    output = nullptr;
+}
+
+uint64_t FrameRecorder::getFramesWritten(){
+    return frames_written;
+}
+
+uint64_t FrameRecorder::getFramesDropped(){
+    return frames_dropped;
+}
+
+void FrameRecorder::captureFrame(uint64_t deadline){
+    uint8_t slot;
+    if(free_slots.pop(slot)){
+        video -> captureFrame(frame_slots[slot]);
+        captured_slots.push(slot);
+    }else{
+        frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Time the next one from this one so they don't drift
+    uint64_t next_deadline = deadline + interval_cycles;
+    capture_event = scheduler -> schedule(next_deadline, [this, next_deadline](uint64_t){ captureFrame(next_deadline); });
+}
+
+void FrameRecorder::writeFrames(){
+    while(true){
+        // Look at this before emptying the queue, so whatever was captured before stop() is written
+        bool finishing = stopping;
+        bool wrote_any = false;
+        uint8_t slot;
+        while(captured_slots.pop(slot)){
+            writeFrame(frame_slots[slot]);
+            free_slots.push(slot);
+            wrote_any = true;
+        }
+        if(finishing) break;
+        if(!wrote_any) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    fflush(output);
+}
+
+void FrameRecorder::writeFrame(const FrameSnapshot &frame){
+    for(int tile = 0; tile < FrameSnapshot::kTileCount; tile++){
+        renderer.drawTile(frame, tile, pixels, FrameSnapshot::kWidth);
+    }
+    for(int pixel = 0; pixel < FrameSnapshot::kWidth * FrameSnapshot::kHeight; pixel++){
+        rgb[pixel * 3] = pixels[pixel] >> 16;
+        rgb[pixel * 3 + 1] = pixels[pixel] >> 8;
+        rgb[pixel * 3 + 2] = pixels[pixel];
+    }
+
+    if(format == PPM) fprintf(output, "P6\n%d %d\n255\n", FrameSnapshot::kWidth, FrameSnapshot::kHeight);
+    fwrite(rgb, 1, sizeof(rgb), output);
+    frames_written.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,135 @@
+#ifndef FRAMERECORDER_H
+#define FRAMERECORDER_H
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "eventscheduler.h"
+#include "glyphrenderer.h"
+#include "spscring.h"
+#include "vram.h"
+
+/**
+ * Writes what's on the display to a file every so many bus cycles, for checking screen output
+ * without one
+ *
+ * Frames are captured on the CPU thread by a scheduled event, so they're taken at the same points in
+ * the program every run no matter how fast the host is. Capturing only copies the video memory into
+ * a free slot, converting and writing it out happens on a thread of our own. If the disk can't keep
+ * up and there's no free slot, the frame is dropped and counted, the processor never waits
+ */
+class FrameRecorder{
+public:
+    enum Format{
+        PPM, // A P6 image per frame, one after the other
+        RAW // Just the 24-bit RGB pixels of each frame
+    };
+
+    /**
+     * How many frames can be waiting to be written
+     */
+    constexpr static size_t kQueueLength = 16;
+
+    /**
+     * @param video The device to capture
+     * @param scheduler The scheduler the captures are timed with
+     * @param interval_cycles How many bus cycles apart the frames are
+     * @param format
+     */
+    FrameRecorder(VRAM *video, EventScheduler *scheduler, uint64_t interval_cycles, Format format);
+    ~FrameRecorder();
+
+    /**
+     * Open the output file and start capturing, from the next interval on
+     *
+     * Must be called while the processor isn't running
+     *
+     * @param path
+     * @param start_cycle The current bus cycle
+     * @return false if the file can't be opened
+     */
+    bool start(std::string path, uint64_t start_cycle);
+
+    /**
+     * Stop capturing, write out the frames still waiting and close the file
+     *
+     * Must be called while the processor isn't running
+     */
+    void stop();
+
+    /**
+     * Frames written to the file so far, safe to call from any thread
+     */
+    uint64_t getFramesWritten();
+
+    /**
+     * Frames dropped because the writer fell behind, safe to call from any thread
+     */
+    uint64_t getFramesDropped();
+
+private:
+    /**
+     * Capture a frame into a free slot if there is one, and schedule the next capture
+     *
+     * @param deadline The cycle this capture was due on
+     */
+    void captureFrame(uint64_t deadline);
+
+    /**
+     * Write out captured frames until stopped, on its own thread
+     */
+    void writeFrames();
+
+    /**
+     * Convert a frame to pixels and write it to the file
+     *
+     * @param frame
+     */
+    void writeFrame(const FrameSnapshot &frame);
+
+    VRAM *video;
+    EventScheduler *scheduler;
+    const uint64_t interval_cycles;
+    const Format format;
+
+    FILE *output = nullptr;
+
+    /**
+     * The pending capture
+     */
+    EventScheduler::EventId capture_event = 0;
+    bool capture_event_pending = false;
+
+    /**
+     * Where frames are captured into. A slot is either free, being filled in by the CPU thread, or
+     * waiting to be written
+     */
+    FrameSnapshot frame_slots[kQueueLength];
+
+    /**
+     * Slots the CPU thread can capture into, refilled by the writer
+     */
+    SPSCRing<uint8_t, kQueueLength> free_slots;
+
+    /**
+     * Slots waiting to be written, in the order they were captured
+     */
+    SPSCRing<uint8_t, kQueueLength> captured_slots;
+
+    std::thread writer;
+    std::atomic<bool> stopping = false;
+
+    std::atomic<uint64_t> frames_written = 0;
+    std::atomic<uint64_t> frames_dropped = 0;
+
+    /**
+     * Frames are drawn into these, writer thread only
+     */
+    GlyphRenderer renderer;
+    uint32_t pixels[FrameSnapshot::kWidth * FrameSnapshot::kHeight];
+    uint8_t rgb[FrameSnapshot::kWidth * FrameSnapshot::kHeight * 3];
+};
+
+#endif // FRAMERECORDER_H
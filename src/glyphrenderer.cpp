@@ -0,0 +1,191 @@
+#include "glyphrenderer.h"
+
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define GLYPH_RENDERER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only let us use the instructions in functions that ask for them, MSVC always does
+#if defined(__GNUC__) || defined(__clang__)
+#define GLYPH_RENDERER_TARGET(instruction_set) __attribute__((target(instruction_set)))
+#else
+#define GLYPH_RENDERER_TARGET(instruction_set)
+#endif
+
+namespace{
+    void drawGlyphScalar(const uint8_t *glyph, size_t glyph_stride, uint32_t foreground, uint32_t background, uint32_t *pixels, size_t pixel_stride){
+        for(int line = 0; line < 8; line++){
+            uint8_t bits = glyph[line * glyph_stride];
+            uint32_t *pixel_line = pixels + line * pixel_stride;
+            for(int bit = 0; bit < 8; bit++){
+                pixel_line[bit] = (bits & (0x80 >> bit)) ? foreground : background;
+            }
+        }
+    }
+
+#ifdef GLYPH_RENDERER_X86
+    GLYPH_RENDERER_TARGET("sse2")
+    void drawGlyphSSE2(const uint8_t *glyph, size_t glyph_stride, uint32_t foreground, uint32_t background, uint32_t *pixels, size_t pixel_stride){
+        const __m128i foreground_pixels = _mm_set1_epi32(foreground);
+        const __m128i background_pixels = _mm_set1_epi32(background);
+        // The bit each pixel is lit by, for the left and the right half of the line
+        const __m128i left_bits = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+        const __m128i right_bits = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+        for(int line = 0; line < 8; line++){
+            __m128i bits = _mm_set1_epi32(glyph[line * glyph_stride]);
+            // All ones where the pixel's bit is set, then pick the colour with it
+            __m128i left_mask = _mm_cmpeq_epi32(_mm_and_si128(bits, left_bits), left_bits);
+            __m128i right_mask = _mm_cmpeq_epi32(_mm_and_si128(bits, right_bits), right_bits);
+            __m128i left = _mm_or_si128(_mm_and_si128(left_mask, foreground_pixels), _mm_andnot_si128(left_mask, background_pixels));
+            __m128i right = _mm_or_si128(_mm_and_si128(right_mask, foreground_pixels), _mm_andnot_si128(right_mask, background_pixels));
+            uint32_t *pixel_line = pixels + line * pixel_stride;
+            _mm_storeu_si128((__m128i*) pixel_line, left);
+            _mm_storeu_si128((__m128i*) (pixel_line + 4), right);
+        }
+    }
+
+    GLYPH_RENDERER_TARGET("avx2")
+    void drawGlyphAVX2(const uint8_t *glyph, size_t glyph_stride, uint32_t foreground, uint32_t background, uint32_t *pixels, size_t pixel_stride){
+        const __m256i foreground_pixels = _mm256_set1_epi32(foreground);
+        const __m256i background_pixels = _mm256_set1_epi32(background);
+        // The bit each pixel of the line is lit by
+        const __m256i pixel_bits = _mm256_set_epi32(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+        for(int line = 0; line < 8; line++){
+            __m256i bits = _mm256_set1_epi32(glyph[line * glyph_stride]);
+            __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(bits, pixel_bits), pixel_bits);
+            _mm256_storeu_si256((__m256i*) (pixels + line * pixel_stride), _mm256_blendv_epi8(background_pixels, foreground_pixels, mask));
+        }
+    }
+#endif
+}
+
+GlyphRenderer::GlyphRenderer(Implementation implementation) : implementation{implementation}{
+    switch(implementation){
+#ifdef GLYPH_RENDERER_X86
+    case SSE2:
+        draw_glyph = drawGlyphSSE2;
+        break;
+    case AVX2:
+        draw_glyph = drawGlyphAVX2;
+        break;
+#endif
+    default:
+        this -> implementation = SCALAR;
+        draw_glyph = drawGlyphScalar;
+    }
+}
+
+void GlyphRenderer::drawTile(const FrameSnapshot &frame, int tile, uint32_t *screen, size_t pixel_stride){
+    int row = tile / FrameSnapshot::kColumns;
+    int column = tile % FrameSnapshot::kColumns;
+    uint8_t foreground = frame.foreground;
+    uint8_t background = frame.background;
+
+    // The 8 lines of the tile, from the cell's glyph or straight from the bitmap
+    const uint8_t *glyph;
+    size_t glyph_stride;
+    if(frame.mode & VRAM::CHARACTER_MODE){
+        uint8_t character = frame.memory[FrameSnapshot::kNameTableOffset + tile];
+        glyph = frame.memory + FrameSnapshot::kPatternTableOffset + character * 8;
+        glyph_stride = 1;
+        if(frame.mode & VRAM::ATTRIBUTE_COLOURS){
+            uint8_t attribute = frame.memory[FrameSnapshot::kAttributeTableOffset + tile];
+            foreground = attribute & 0x0F;
+            background = attribute >> 4;
+        }
+    }else{
+        glyph = frame.memory + row * FrameSnapshot::kTileSize * FrameSnapshot::kColumns + column;
+        glyph_stride = FrameSnapshot::kColumns;
+    }
+
+    uint32_t *pixels = screen + row * FrameSnapshot::kTileSize * pixel_stride + column * FrameSnapshot::kTileSize;
+    draw_glyph(glyph, glyph_stride, 0xFF000000 | VRAM::kPalette[foreground], 0xFF000000 | VRAM::kPalette[background], pixels, pixel_stride);
+}
+
+GlyphRenderer::Implementation GlyphRenderer::getImplementation(){
+    return implementation;
+}
+
+bool GlyphRenderer::isSupported(Implementation implementation){
+    switch(implementation){
+    case SCALAR:
+        return true;
+#ifdef GLYPH_RENDERER_X86
+#if defined(__GNUC__) || defined(__clang__)
+    case SSE2:
+        return __builtin_cpu_supports("sse2");
+    case AVX2:
+        return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    case SSE2:
+        return true;
+    case AVX2:{
+        // The processor has to have it, and the OS has to save the AVX registers
+        int info[4];
+        __cpuid(info, 1);
+        bool os_saves_avx = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        return os_saves_avx && (info[1] & (1 << 5));
+    }
+#endif
+#endif
+    default:
+        return false;
+    }
+}
+
+GlyphRenderer::Implementation GlyphRenderer::bestImplementation(){
+    if(isSupported(AVX2)) return AVX2;
+    if(isSupported(SSE2)) return SSE2;
+    return SCALAR;
+}
+
+const char *GlyphRenderer::implementationName(Implementation implementation){
+    switch(implementation){
+    case SCALAR:
+        return "scalar";
+    case SSE2:
+        return "SSE2";
+    case AVX2:
+        return "AVX2";
+    }
+    return "unknown";
+}
+
+double GlyphRenderer::benchmark(Implementation implementation, std::chrono::milliseconds duration){
+    constexpr int kColumns = 32;
+    constexpr int kRows = 24;
+    constexpr size_t kPixelStride = kColumns * 8;
+
+    GlyphRenderer renderer(implementation);
+    std::vector<uint32_t> pixels(kPixelStride * kRows * 8);
+    // Something that isn't all zeroes or all ones, so both colours get picked
+    uint8_t glyphs[256 * 8];
+    for(int i = 0; i < 256 * 8; i++) glyphs[i] = (uint8_t) (i * 37 + (i >> 3));
+
+    uint64_t glyphs_drawn = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + duration;
+    auto now = start;
+    // Check the time once per screen, and draw different characters every time
+    for(uint32_t frame = 0; now < end; frame++){
+        for(int cell = 0; cell < kColumns * kRows; cell++){
+            uint8_t character = (uint8_t) (cell + frame);
+            uint32_t *cell_pixels = pixels.data() + (cell / kColumns) * 8 * kPixelStride + (cell % kColumns) * 8;
+            renderer.drawGlyph(glyphs + character * 8, 1, 0xFFFFFFFF, 0xFF000000 | frame, cell_pixels, kPixelStride);
+        }
+        glyphs_drawn += kColumns * kRows;
+        now = std::chrono::steady_clock::now();
+    }
+
+    // Make sure the drawing isn't optimised away
+    volatile uint32_t sink = 0;
+    for(uint32_t pixel : pixels) sink = sink + pixel;
+
+    return glyphs_drawn / std::chrono::duration<double>(now - start).count();
+}
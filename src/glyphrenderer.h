@@ -0,0 +1,93 @@
+#ifndef GLYPHRENDERER_H
+#define GLYPHRENDERER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "vram.h"
+
+/**
+ * Expands 8x8 1-bit glyphs into 32-bit pixels, the inner loop of drawing the display
+ *
+ * There's a scalar version that works everywhere, and SSE2 and AVX2 versions on x86 that turn a
+ * whole line of the glyph into pixels at once. The best one the processor supports is picked when
+ * the renderer is created
+ */
+class GlyphRenderer{
+public:
+    enum Implementation{
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    /**
+     * Use the given implementation, it must be supported
+     *
+     * @param implementation
+     */
+    GlyphRenderer(Implementation implementation = bestImplementation());
+
+    /**
+     * Draw an 8x8 glyph
+     *
+     * @param glyph The 8 lines of the glyph, most significant bit on the left
+     * @param glyph_stride How far apart the lines of the glyph are, in bytes
+     * @param foreground Colour of the set bits
+     * @param background Colour of the clear bits
+     * @param pixels The top left pixel to draw to
+     * @param pixel_stride How far apart the lines of pixels are, in pixels
+     */
+    void drawGlyph(const uint8_t *glyph, size_t glyph_stride, uint32_t foreground, uint32_t background, uint32_t *pixels, size_t pixel_stride){
+        draw_glyph(glyph, glyph_stride, foreground, background, pixels, pixel_stride);
+    }
+
+    /**
+     * Draw a tile of a frame, from the bitmap or from the glyph of the character in the cell
+     *
+     * @param frame
+     * @param tile
+     * @param screen The top left pixel of the screen
+     * @param pixel_stride How far apart the lines of pixels are, in pixels
+     */
+    void drawTile(const FrameSnapshot &frame, int tile, uint32_t *screen, size_t pixel_stride);
+
+    Implementation getImplementation();
+
+    /**
+     * Whether the processor we're running on can use an implementation
+     *
+     * @param implementation
+     */
+    static bool isSupported(Implementation implementation);
+
+    /**
+     * The fastest implementation the processor we're running on can use
+     */
+    static Implementation bestImplementation();
+
+    /**
+     * Human readable name of an implementation
+     *
+     * @param implementation
+     */
+    static const char *implementationName(Implementation implementation);
+
+    /**
+     * Measure how fast an implementation draws a screenful of glyphs over and over
+     *
+     * @param implementation
+     * @param duration How long to measure for
+     * @return Glyphs drawn per second
+     */
+    static double benchmark(Implementation implementation, std::chrono::milliseconds duration);
+
+private:
+    typedef void (*DrawGlyphFunction)(const uint8_t *glyph, size_t glyph_stride, uint32_t foreground, uint32_t background, uint32_t *pixels, size_t pixel_stride);
+
+    Implementation implementation;
+    DrawGlyphFunction draw_glyph;
+};
+
+#endif // GLYPHRENDERER_H
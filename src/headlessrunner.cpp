@@ -0,0 +1,136 @@
+#include "headlessrunner.h"
+
+#include <QCoreApplication>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "log.h"
+
+HeadlessRunner::HeadlessRunner(Emulator *emulator, std::string image_path, int stats_interval_millis, int run_for_millis, FILE *stats_stream)
+    : emulator{emulator}, image_path{image_path}, stats_interval_millis{stats_interval_millis}, run_for_millis{run_for_millis}, stats_stream{stats_stream} {}
+
+HeadlessRunner::~HeadlessRunner(){
+    delete frame_recorder;
+    delete sound_recorder;
+}
+
+void HeadlessRunner::setFrameCapture(std::string path, uint64_t interval_cycles, FrameRecorder::Format format){
+    capture_path = path;
+    capture_interval_cycles = interval_cycles;
+    capture_format = format;
+}
+
+void HeadlessRunner::setAudioCapture(std::string path){
+    audio_path = path;
+}
+
+void HeadlessRunner::start(){
+    // Read the image and load it into memory, same as the editor does after assembling
+    std::ifstream image_input_stream(image_path, std::ios::binary);
+    char in_buf[Emulator::kMemorySize];
+    if(!image_input_stream.read(in_buf, Emulator::kMemorySize) && !image_input_stream.eof()){
+        Log::Critical() << "Could not read image " << QString::fromStdString(image_path);
+        QCoreApplication::exit(1);
+        return;
+    }
+    size_t image_length = image_input_stream.gcount();
+    if(image_length > Emulator::kMemorySize - emulator -> getProgramOffset()){
+        Log::Warning() << "Image " << QString::fromStdString(image_path) << " runs past the end of memory, the rest of it is left out";
+    }
+    EmulatorHelper::replaceMemory((uint8_t*) in_buf, emulator -> getProgramOffset(), image_length);
+    emulator -> resetCPU();
+
+    // Capture the display from the first interval on
+    if(!capture_path.empty()){
+        if(emulator -> getVideo() == nullptr){
+            Log::Critical() << "This machine has no display to capture";
+            QCoreApplication::exit(1);
+            return;
+        }
+        frame_recorder = new FrameRecorder(emulator -> getVideo(), emulator -> getScheduler(), capture_interval_cycles, capture_format);
+        if(!frame_recorder -> start(capture_path, emulator -> getBusCycle())){
+            Log::Critical() << "Could not open " << QString::fromStdString(capture_path) << " to capture the display to";
+            QCoreApplication::exit(1);
+            return;
+        }
+    }
+
+    // Record the sound from the reset on
+    if(!audio_path.empty()){
+        if(emulator -> getSoundChip() == nullptr){
+            Log::Critical() << "This machine has no sound chip to record";
+            QCoreApplication::exit(1);
+            return;
+        }
+        sound_recorder = new SoundRecorder(emulator -> getSoundChip(), emulator -> getScheduler(), emulator -> clock_speed);
+        if(!sound_recorder -> start(audio_path, emulator -> getBusCycle())){
+            Log::Critical() << "Could not open " << QString::fromStdString(audio_path) << " to record the sound to";
+            QCoreApplication::exit(1);
+            return;
+        }
+    }
+
+    Log::Info() << "Running " << QString::fromStdString(image_path) << " headless";
+    // There's nobody to reset a halted processor, so a halt ends the run
+    connect(emulator, &Emulator::halted, this, &HeadlessRunner::handleProcessorHalted);
+    emulator -> run();
+
+    // Dump the statistics every so often
+    if(stats_interval_millis > 0){
+        stats_timer = new QTimer(this);
+        connect(stats_timer, &QTimer::timeout, this, &HeadlessRunner::printStats);
+        stats_timer -> start(stats_interval_millis);
+    }
+
+    // Stop after the requested time, if there is one
+    if(run_for_millis > 0){
+        QTimer::singleShot(run_for_millis, this, &HeadlessRunner::finish);
+    }
+}
+
+void HeadlessRunner::printStats(){
+    TelemetrySample sample = emulator -> getTelemetry() -> read();
+    bool within_tolerance = std::abs(sample.throttle_error) <= ProcessorRunWorker::kThrottleTolerance;
+    fprintf(stats_stream, "cycles=%llu instructions=%llu interrupts=%llu clock_speed=%.0fHz mips=%.2f throttle_error=%+.3f%%%s stop_latency=%.1fus",
+           (unsigned long long) sample.cycles_executed,
+           (unsigned long long) sample.instructions_retired,
+           (unsigned long long) sample.interrupts_taken,
+           sample.effective_clock_speed,
+           sample.effective_instruction_rate / 1e6,
+           sample.throttle_error * 100,
+           within_tolerance ? "" : " (out of tolerance)",
+           sample.stop_latency_nanos / 1e3);
+    if(frame_recorder != nullptr){
+        fprintf(stats_stream, " frames=%llu dropped_frames=%llu",
+                (unsigned long long) frame_recorder -> getFramesWritten(),
+                (unsigned long long) frame_recorder -> getFramesDropped());
+    }
+    if(sound_recorder != nullptr){
+        fprintf(stats_stream, " samples=%llu dropped_sound_events=%llu",
+                (unsigned long long) sound_recorder -> getSamplesWritten(),
+                (unsigned long long) emulator -> getSoundChip() -> getDroppedEvents());
+    }
+    fprintf(stats_stream, "\n");
+    fflush(stats_stream);
+}
+
+void HeadlessRunner::finish(){
+    if(stats_timer != nullptr) stats_timer -> stop();
+    // The final statistics (and how long stopping took) are published once the processor stops
+    emulator -> interrupt();
+    // Write out what's still queued up before the final count
+    if(frame_recorder != nullptr) frame_recorder -> stop();
+    if(sound_recorder != nullptr) sound_recorder -> stop(emulator -> getBusCycle());
+    printStats();
+    QCoreApplication::quit();
+}
+
+void HeadlessRunner::handleProcessorHalted(uint16_t pc, mos6502::HaltReason reason){
+    fprintf(stats_stream, "halted pc=$%04x reason=%s\n", pc, Emulator::haltReasonToString(reason).toStdString().c_str());
+    if(reason == mos6502::PROTECTION_FAULT){
+        fprintf(stats_stream, "fault=%s\n", Emulator::protectionFaultToString(emulator -> getProtectionFault()).toStdString().c_str());
+    }
+    finish();
+}
@@ -0,0 +1,126 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QObject>
+#include <QTimer>
+
+#include <cstdio>
+#include <string>
+
+#include "emulator.h"
+#include "framerecorder.h"
+#include "soundrecorder.h"
+
+/**
+ * Runs a program on the emulator without the UI, for batch jobs
+ *
+ * Loads an assembled image the same way the editor does, runs it, and periodically
+ * dumps the run-time statistics to stdout (or stderr, when stdout is the serial port)
+ */
+class HeadlessRunner : public QObject{
+    Q_OBJECT
+public:
+    /**
+     * @param emulator The emulator instance
+     * @param image_path Path to the assembled image to run
+     * @param stats_interval_millis How often to print the statistics, 0 to only print them at the end
+     * @param run_for_millis How long to run for before quitting, 0 to run until killed
+     * @param stats_stream Where to print the statistics
+     */
+    HeadlessRunner(Emulator *emulator, std::string image_path, int stats_interval_millis, int run_for_millis, FILE *stats_stream = stdout);
+    ~HeadlessRunner();
+
+    /**
+     * Write the display to a file while running, must be called before start()
+     *
+     * @param path
+     * @param interval_cycles How many bus cycles apart the frames are
+     * @param format
+     */
+    void setFrameCapture(std::string path, uint64_t interval_cycles, FrameRecorder::Format format);
+
+    /**
+     * Record the sound chip to a WAV file while running, must be called before start()
+     *
+     * @param path
+     */
+    void setAudioCapture(std::string path);
+
+    /**
+     * Load the image and start running. Quits the application if the image can't be loaded
+     */
+    void start();
+
+    /**
+     * Print the current statistics to the stats stream
+     */
+    void printStats();
+
+    /**
+     * Stop the emulator, print the final statistics and quit the application
+     */
+    void finish();
+
+    /**
+     * Report where and why the processor halted, then finish
+     *
+     * @param pc The address of the instruction that halted the processor
+     * @param reason
+     */
+    void handleProcessorHalted(uint16_t pc, mos6502::HaltReason reason);
+
+private:
+    /**
+     * The emulator instance
+     */
+    Emulator *emulator;
+
+    /**
+     * Path to the assembled image to run
+     */
+    const std::string image_path;
+
+    /**
+     * How often to print the statistics
+     */
+    const int stats_interval_millis;
+
+    /**
+     * How long to run for
+     */
+    const int run_for_millis;
+
+    /**
+     * Where the statistics are printed
+     */
+    FILE *stats_stream;
+
+    /**
+     * Periodically prints the statistics
+     */
+    QTimer *stats_timer = nullptr;
+
+    /**
+     * Where the display is written to, empty if it isn't
+     */
+    std::string capture_path;
+    uint64_t capture_interval_cycles = 0;
+    FrameRecorder::Format capture_format = FrameRecorder::PPM;
+
+    /**
+     * Writes the display to capture_path while running
+     */
+    FrameRecorder *frame_recorder = nullptr;
+
+    /**
+     * Where the sound is recorded to, empty if it isn't
+     */
+    std::string audio_path;
+
+    /**
+     * Records the sound chip to audio_path while running
+     */
+    SoundRecorder *sound_recorder = nullptr;
+};
+
+#endif // HEADLESSRUNNER_H
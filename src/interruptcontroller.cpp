@@ -0,0 +1,38 @@
+#include "interruptcontroller.h"
+
+#include "mos6502.h"
+
+unsigned InterruptController::allocateLine(){
+    unsigned line = allocated_lines.fetch_add(1, std::memory_order_relaxed);
+    return line < kMaxLines ? line : kMaxLines;
+}
+
+void InterruptController::setIRQ(unsigned line, bool asserted){
+    if(asserted) raiseIRQ(line);
+    else lowerIRQ(line);
+}
+
+void InterruptController::raiseIRQ(unsigned line){
+    if(line >= kMaxLines) return;
+    pending.fetch_or(1u << line, std::memory_order_relaxed);
+}
+
+void InterruptController::lowerIRQ(unsigned line){
+    if(line >= kMaxLines) return;
+    pending.fetch_and(~(1u << line), std::memory_order_relaxed);
+}
+
+void InterruptController::setNMI(unsigned line, bool asserted){
+    if(line >= kMaxLines) return;
+    if(asserted){
+        // Only the edge counts, further lines going up while one is already asserted don't
+        uint32_t previous_lines = nmi_lines.fetch_or(1u << line, std::memory_order_relaxed);
+        if(previous_lines == 0) pending.fetch_or(mos6502::NMI_PENDING, std::memory_order_relaxed);
+    }else{
+        nmi_lines.fetch_and(~(1u << line), std::memory_order_relaxed);
+    }
+}
+
+std::atomic<uint32_t> *InterruptController::getPendingWord(){
+    return &pending;
+}
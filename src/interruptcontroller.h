@@ -0,0 +1,84 @@
+#ifndef INTERRUPTCONTROLLER_H
+#define INTERRUPTCONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Combines the interrupt lines of the devices into the single word the processor samples between instructions
+ *
+ * Every device gets a line of its own. IRQ is level-triggered, the processor keeps taking it as long as any
+ * line is asserted and interrupts are enabled, so a device must release its line once it's been serviced.
+ * NMI is edge-triggered, it's latched when the first NMI line is asserted and the processor clears the latch
+ * when it takes it.
+ *
+ * Every method is lock-free and can be called from any thread, so devices living outside the run worker can
+ * raise interrupts too
+ */
+class InterruptController{
+public:
+    /**
+     * The most lines the controller can have, the top bit of the pending word is the NMI latch
+     */
+    constexpr static unsigned kMaxLines = 31;
+
+    /**
+     * Get a line for a device
+     *
+     * @return The line number, kMaxLines if they've all been given out
+     */
+    unsigned allocateLine();
+
+    /**
+     * Assert or release an IRQ line
+     *
+     * @param line
+     * @param asserted
+     */
+    void setIRQ(unsigned line, bool asserted);
+
+    /**
+     * Assert an IRQ line
+     *
+     * @param line
+     */
+    void raiseIRQ(unsigned line);
+
+    /**
+     * Release an IRQ line
+     *
+     * @param line
+     */
+    void lowerIRQ(unsigned line);
+
+    /**
+     * Assert or release an NMI line. The NMI is latched when the first line is asserted
+     *
+     * @param line
+     * @param asserted
+     */
+    void setNMI(unsigned line, bool asserted);
+
+    /**
+     * Get the word the processor samples, see mos6502::SetInterruptPending
+     */
+    std::atomic<uint32_t> *getPendingWord();
+
+private:
+    /**
+     * The asserted IRQ lines, one bit per line, and the NMI latch
+     */
+    std::atomic<uint32_t> pending = 0;
+
+    /**
+     * The asserted NMI lines, one bit per line
+     */
+    std::atomic<uint32_t> nmi_lines = 0;
+
+    /**
+     * How many lines were given out
+     */
+    std::atomic<unsigned> allocated_lines = 0;
+};
+
+#endif // INTERRUPTCONTROLLER_H
@@ -0,0 +1,105 @@
+#include "keyboard.h"
+
+#include <algorithm>
+
+Keyboard::Keyboard(uint16_t base_address, EventScheduler *scheduler, InterruptController *interrupt_controller, const std::atomic<int> &clock_speed) : MemoryMappedDevice(base_address, kRegisterCount),
+                                                                                                                                                       scheduler{scheduler},
+                                                                                                                                                       interrupt_controller{interrupt_controller},
+                                                                                                                                                       clock_speed{clock_speed}{
+    irq_line = interrupt_controller -> allocateLine();
+    needs_sync = true;
+}
+
+Keyboard::~Keyboard(){
+    // Don't leave callbacks to us behind
+    if(scan_event_pending) scheduler -> cancel(scan_event);
+    interrupt_controller -> lowerIRQ(irq_line);
+}
+
+void Keyboard::sync(uint64_t cycle){
+    current_cycle = cycle;
+}
+
+bool Keyboard::pushKey(uint8_t character, uint8_t modifiers){
+    return queue.push({character, modifiers, std::chrono::steady_clock::now()});
+}
+
+bool Keyboard::takeResponse(std::chrono::steady_clock::time_point &pressed_at){
+    if(!response_pending) return false;
+    pressed_at = responded_key_pressed_at;
+    response_pending = false;
+    return true;
+}
+
+bool Keyboard::setValue(uint16_t address, uint8_t value){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return false;
+
+    if(relative_address == CONTROL){
+        control = value;
+        updateScanning();
+        updateIRQ();
+    }
+    return true;
+}
+
+uint8_t Keyboard::getValue(uint16_t address){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+
+    if(relative_address == DATA && key_available){
+        // The key has been taken, the next scan can latch another one
+        key_available = false;
+        irq_pending = false;
+        updateIRQ();
+        responded_key_pressed_at = latched_key.pressed_at;
+        response_pending = true;
+        return latched_key.character;
+    }
+    return peekValue(address);
+}
+
+uint8_t Keyboard::peekValue(uint16_t address){
+    size_t relative_address = address - this -> base_address;
+    switch(relative_address){
+    case DATA:
+        return latched_key.character;
+    case STATUS:
+        return (key_available ? KEY_AVAILABLE : 0) | (irq_pending ? IRQ_PENDING : 0);
+    case CONTROL:
+        return control;
+    case MODIFIERS:
+        return latched_key.modifiers;
+    }
+    return 0xFF;
+}
+
+void Keyboard::updateScanning(){
+    bool enabled = control & SCAN_ENABLE;
+    if(enabled && !scan_event_pending){
+        uint64_t deadline = current_cycle + 1;
+        scan_event = scheduler -> schedule(deadline, [this, deadline](uint64_t){ scan(deadline); });
+        scan_event_pending = true;
+    }else if(!enabled && scan_event_pending){
+        scheduler -> cancel(scan_event);
+        scan_event_pending = false;
+    }
+}
+
+void Keyboard::scan(uint64_t deadline){
+    // Keys stay queued until the processor has read the last one
+    if(!key_available && queue.pop(latched_key)){
+        key_available = true;
+        irq_pending = true;
+        updateIRQ();
+    }
+
+    uint64_t next_deadline = deadline + std::max(1, clock_speed.load(std::memory_order_relaxed) / kScanRate);
+    scan_event = scheduler -> schedule(next_deadline, [this, next_deadline](uint64_t){ scan(next_deadline); });
+}
+
+void Keyboard::updateIRQ(){
+    interrupt_controller -> setIRQ(irq_line, irq_pending && (control & IRQ_ENABLE));
+}
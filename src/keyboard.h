@@ -0,0 +1,185 @@
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include <atomic>
+#include <chrono>
+
+#include "eventscheduler.h"
+#include "interruptcontroller.h"
+#include "memorymappeddevice.h"
+#include "spscring.h"
+
+/**
+ * A key typed on the host, as queued for the keyboard
+ */
+struct KeyEvent{
+    /**
+     * The ASCII code of the key
+     */
+    uint8_t character;
+
+    /**
+     * The Keyboard::Modifier bits held with it
+     */
+    uint8_t modifiers;
+
+    /**
+     * When the host queued it, to measure how long the program takes to respond
+     */
+    std::chrono::steady_clock::time_point pressed_at;
+};
+
+/**
+ * An ASCII keyboard
+ *
+ * The UI thread pushes keys into a ring and never touches the registers. While scanning is enabled the
+ * keyboard looks at the ring from a scheduler event, so between instructions, and latches one key at a
+ * time: the next one is only picked up once the processor has read the last one out of DATA. Keys
+ * typed while the processor isn't keeping up wait in the ring, and only what doesn't fit there is
+ * dropped
+ *
+ * How long it takes from a key being typed until the first snapshot after the processor read it is
+ * reported through the telemetry as the input latency
+ */
+class Keyboard : public MemoryMappedDevice{
+public:
+    /**
+     * The registers, relative to the base address
+     */
+    enum Register{
+        DATA = 0x0, // Reading it takes the key and acknowledges the interrupt
+        STATUS = 0x1,
+        CONTROL = 0x2,
+        MODIFIERS = 0x3 // The modifiers held with the key in DATA
+    };
+
+    /**
+     * Bits of the status register
+     */
+    enum StatusBit{
+        KEY_AVAILABLE = 0x01,
+        IRQ_PENDING = 0x80
+    };
+
+    /**
+     * Bits of the control register
+     */
+    enum ControlBit{
+        SCAN_ENABLE = 0x01,
+        IRQ_ENABLE = 0x02
+    };
+
+    /**
+     * Bits of the modifiers register
+     */
+    enum Modifier{
+        SHIFT = 0x01,
+        CONTROL_KEY = 0x02,
+        ALT = 0x04
+    };
+
+    /**
+     * Number of registers
+     */
+    constexpr static size_t kRegisterCount = 0x4;
+
+    /**
+     * How many keys can be waiting for the processor
+     */
+    constexpr static size_t kQueueLength = 64;
+
+    /**
+     * How many times per emulated second the queue is looked at while scanning
+     */
+    constexpr static int kScanRate = 1000;
+
+    typedef SPSCRing<KeyEvent, kQueueLength> KeyQueue;
+
+    /**
+     * @param base_address
+     * @param scheduler Where the scans are scheduled
+     * @param interrupt_controller Where the IRQ output goes, the keyboard takes a line of its own
+     * @param clock_speed The processor clock the scan rate is converted with
+     */
+    Keyboard(uint16_t base_address, EventScheduler *scheduler, InterruptController *interrupt_controller, const std::atomic<int> &clock_speed);
+    ~Keyboard();
+
+    bool setValue(uint16_t address, uint8_t value) override;
+    uint8_t getValue(uint16_t address) override;
+    uint8_t peekValue(uint16_t address) override;
+    void sync(uint64_t cycle) override;
+
+    /**
+     * Queue a key for the processor, UI thread only
+     *
+     * @param character ASCII
+     * @param modifiers Modifier bits
+     * @return false if the queue is full and the key was dropped
+     */
+    bool pushKey(uint8_t character, uint8_t modifiers);
+
+    /**
+     * Take the time the last key the processor read was typed at, if it hasn't been taken yet. Called
+     * by the run worker once a snapshot shows the processor's response
+     *
+     * @param pressed_at Set to when the key was typed
+     * @return false if no key was read since the last call
+     */
+    bool takeResponse(std::chrono::steady_clock::time_point &pressed_at);
+
+private:
+    /**
+     * Start scanning if it's enabled, stop if it isn't
+     */
+    void updateScanning();
+
+    /**
+     * Look at the queue and latch the next key if the last one was read
+     *
+     * @param deadline The cycle this was due on, the next one is timed from here
+     */
+    void scan(uint64_t deadline);
+
+    /**
+     * Drive the IRQ line from irq_pending
+     */
+    void updateIRQ();
+
+    EventScheduler *scheduler;
+    InterruptController *interrupt_controller;
+    const std::atomic<int> &clock_speed;
+
+    /**
+     * Our line on the interrupt controller
+     */
+    unsigned irq_line;
+
+    /**
+     * The bus cycle we've been synced to
+     */
+    uint64_t current_cycle = 0;
+
+    /**
+     * The pending scan
+     */
+    EventScheduler::EventId scan_event = 0;
+    bool scan_event_pending = false;
+
+    KeyQueue queue;
+
+    /**
+     * The key the processor sees
+     */
+    KeyEvent latched_key = {};
+    bool key_available = false;
+    bool irq_pending = false;
+    uint8_t control = 0;
+
+    /**
+     * The last key read, until the run worker takes it
+     */
+    std::chrono::steady_clock::time_point responded_key_pressed_at;
+    bool response_pending = false;
+};
+
+#endif // KEYBOARD_H
@@ -0,0 +1,250 @@
+#include "machineconfig.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+
+#include <map>
+
+#include "acia.h"
+#include "dma.h"
+#include "keyboard.h"
+#include "memoryarena.h"
+#include "mmu.h"
+#include "pagetable.h"
+#include "soundchip.h"
+#include "via.h"
+#include "vram.h"
+
+const QString MachineConfig::kDefaultPath = ":/config/machine.ini";
+
+namespace{
+    /**
+     * The device types, by the name used in the file
+     */
+    const std::map<QString, DeviceConfig::Type> kDeviceTypes = {
+        {"ram", DeviceConfig::RAM},
+        {"rom", DeviceConfig::ROM},
+        {"via", DeviceConfig::VIA},
+        {"acia", DeviceConfig::ACIA},
+        {"video", DeviceConfig::VIDEO},
+        {"sound", DeviceConfig::SOUND},
+        {"keyboard", DeviceConfig::KEYBOARD},
+        {"dma", DeviceConfig::DMA},
+        {"mmu", DeviceConfig::MMU},
+        {"plugin", DeviceConfig::PLUGIN}
+    };
+
+    /**
+     * Read a number, in decimal or in hex with a 0x in front
+     *
+     * @return false if it isn't one
+     */
+    bool readNumber(const QSettings &settings, QString key, size_t &value){
+        if(!settings.contains(key)) return false;
+        bool ok;
+        value = settings.value(key).toString().trimmed().toULongLong(&ok, 0);
+        return ok;
+    }
+
+    /**
+     * An address range on the bus, inclusive at both ends like the bus has them
+     */
+    struct Range{
+        size_t first;
+        size_t last;
+        std::string name;
+    };
+}
+
+size_t DeviceConfig::getAddressSpaceLength() const{
+    switch(type){
+    case RAM:
+    case ROM:
+        // The length of memory is its last offset, so the bank register of a ROM fits in front of it
+        return length + 1;
+    case PLUGIN:
+        return length;
+    case VIA:
+        return VIA::kRegisterCount;
+    case ACIA:
+        return ACIA::kRegisterCount;
+    case VIDEO:
+        return VRAM::kRegisterSpace + FrameSnapshot::kMemorySize;
+    case SOUND:
+        return SoundChip::kRegisterCount;
+    case KEYBOARD:
+        return Keyboard::kRegisterCount;
+    case DMA:
+        return DMA::kRegisterCount;
+    case MMU:
+        return MMU::kRegisterCount;
+    }
+    return 0;
+}
+
+size_t DeviceConfig::getArenaSize() const{
+    switch(type){
+    case RAM:
+        return MemoryArena::roundUp(length);
+    case ROM:
+        return MemoryArena::roundUp(length * banks);
+    case MMU:
+        return MemoryArena::roundUp(ram_size) + MemoryArena::roundUp(rom_size);
+    default:
+        // Everything else keeps its registers to itself, and plugins bring their own memory
+        return 0;
+    }
+}
+
+bool MachineConfig::load(QString path, MachineConfig &config, QString &error){
+    if(!QFile::exists(path)){
+        error = "there is no " + path;
+        return false;
+    }
+    QSettings settings(path, QSettings::IniFormat);
+    if(settings.status() != QSettings::NoError){
+        error = "can't parse " + path;
+        return false;
+    }
+
+    config = MachineConfig();
+    size_t program_offset = config.program_offset;
+    if(settings.contains("machine/program_offset") && (!readNumber(settings, "machine/program_offset", program_offset) || program_offset > 0xFFFF)){
+        error = "machine/program_offset isn't an address";
+        return false;
+    }
+    config.program_offset = program_offset;
+
+    // Plugin libraries are looked for here, relative to the config file
+    QDir plugin_directory = QFileInfo(path).absoluteDir();
+    if(settings.contains("machine/plugin_directory")){
+        plugin_directory = QDir(plugin_directory.absoluteFilePath(settings.value("machine/plugin_directory").toString()));
+    }
+
+    // Every other group is a device
+    std::vector<Range> ranges;
+    bool unique_device_seen[DeviceConfig::PLUGIN + 1] = {};
+    for(const QString &group : settings.childGroups()){
+        if(group == "machine") continue;
+        settings.beginGroup(group);
+        DeviceConfig device;
+        device.name = group.toStdString();
+
+        auto type = kDeviceTypes.find(settings.value("type").toString().trimmed().toLower());
+        if(type == kDeviceTypes.end()){
+            error = group + " has no type, or one we don't know";
+            return false;
+        }
+        device.type = type -> second;
+        // The UI and the headless runner talk to these, so there can only be one of each
+        bool unique = device.type == DeviceConfig::ACIA || device.type == DeviceConfig::VIDEO ||
+                      device.type == DeviceConfig::SOUND || device.type == DeviceConfig::KEYBOARD;
+        if(unique && unique_device_seen[device.type]){
+            error = group + " is the second " + settings.value("type").toString() + ", there can only be one";
+            return false;
+        }
+        unique_device_seen[device.type] = true;
+
+        size_t base_address;
+        if(!readNumber(settings, "base", base_address) || base_address > 0xFFFF){
+            error = group + "/base isn't an address";
+            return false;
+        }
+        device.base_address = base_address;
+
+        // Any of r, w and x, e.g. rx for memory that can't be written
+        if(settings.contains("permissions")){
+            QString permissions = settings.value("permissions").toString().trimmed().toLower();
+            device.permissions = 0;
+            for(QChar permission : permissions){
+                if(permission == 'r') device.permissions |= PageTable::READ;
+                else if(permission == 'w') device.permissions |= PageTable::WRITE;
+                else if(permission == 'x') device.permissions |= PageTable::EXECUTE;
+                else{
+                    error = group + "/permissions can only have r, w and x in it";
+                    return false;
+                }
+            }
+            if((device.permissions & PageTable::EXECUTE) && !(device.permissions & PageTable::READ)){
+                error = group + "/permissions has x without r, instructions' operands are read like data";
+                return false;
+            }
+        }
+
+        switch(device.type){
+        case DeviceConfig::ROM:
+            if(settings.contains("banks") && (!readNumber(settings, "banks", device.banks) || device.banks == 0)){
+                error = group + "/banks isn't a number of banks";
+                return false;
+            }
+            // Fall through, ROM has a length like RAM
+        case DeviceConfig::RAM:
+            if(!readNumber(settings, "length", device.length) || device.length == 0){
+                error = group + "/length isn't a size";
+                return false;
+            }
+            device.file = settings.value("file").toString().toStdString();
+            break;
+        case DeviceConfig::MMU:
+            if(!readNumber(settings, "ram_size", device.ram_size) || !readNumber(settings, "rom_size", device.rom_size)){
+                error = group + " needs a ram_size and a rom_size";
+                return false;
+            }
+            device.file = settings.value("rom_file").toString().toStdString();
+            // Each window is base:size, and they're separated by commas
+            for(const QString &window : settings.value("windows").toStringList()){
+                QStringList parts = window.split(':');
+                bool base_ok = false, size_ok = false;
+                size_t window_base = parts.size() == 2 ? parts[0].trimmed().toULongLong(&base_ok, 0) : 0;
+                size_t window_size = parts.size() == 2 ? parts[1].trimmed().toULongLong(&size_ok, 0) : 0;
+                if(!base_ok || !size_ok || window_size == 0 || (window_base % PageTable::kPageSize) || (window_size % PageTable::kPageSize)){
+                    error = group + "/windows: " + window + " isn't a page aligned base:size";
+                    return false;
+                }
+                device.windows.push_back({(uint16_t) window_base, window_size});
+                ranges.push_back({window_base, window_base + window_size - 1, device.name + " window"});
+            }
+            if(device.windows.size() > MMU::kMaxWindows){
+                error = group + " has more than " + QString::number((int) MMU::kMaxWindows) + " windows";
+                return false;
+            }
+            break;
+        case DeviceConfig::PLUGIN:
+            if(!readNumber(settings, "length", device.length) || device.length == 0){
+                error = group + "/length isn't a size";
+                return false;
+            }
+            if(settings.value("library").toString().isEmpty()){
+                error = group + " needs a library";
+                return false;
+            }
+            device.file = plugin_directory.absoluteFilePath(settings.value("library").toString()).toStdString();
+            // Options with commas in them come back as a list
+            device.options = settings.value("options").toStringList().join(",").toStdString();
+            break;
+        default:
+            break;
+        }
+        settings.endGroup();
+
+        ranges.push_back({base_address, base_address + device.getAddressSpaceLength() - 1, device.name});
+        config.devices.push_back(device);
+    }
+
+    // Everything has to fit, and nothing can be on top of anything else
+    for(size_t i = 0; i < ranges.size(); i++){
+        if(ranges[i].last > 0xFFFF){
+            error = QString::fromStdString(ranges[i].name) + " runs past the end of the address space";
+            return false;
+        }
+        for(size_t j = 0; j < i; j++){
+            if(ranges[i].first <= ranges[j].last && ranges[j].first <= ranges[i].last){
+                error = QString::fromStdString(ranges[i].name) + " overlaps " + QString::fromStdString(ranges[j].name);
+                return false;
+            }
+        }
+    }
+    return true;
+}
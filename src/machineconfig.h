@@ -0,0 +1,124 @@
+#ifndef MACHINECONFIG_H
+#define MACHINECONFIG_H
+
+#include <QString>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pagetable.h"
+
+/**
+ * One device of a machine, as described in its config file
+ */
+struct DeviceConfig{
+    enum Type{
+        RAM,
+        ROM,
+        VIA,
+        ACIA,
+        VIDEO,
+        SOUND,
+        KEYBOARD,
+        DMA,
+        MMU,
+        PLUGIN
+    };
+
+    /**
+     * A bank window of an MMU
+     */
+    struct Window{
+        uint16_t base_address;
+        size_t size;
+    };
+
+    /**
+     * The name of the device's group in the file
+     */
+    std::string name;
+
+    Type type;
+    uint16_t base_address = 0;
+
+    /**
+     * RAM, ROM and plugins: size of the memory, or how many addresses the device has
+     */
+    size_t length = 0;
+
+    /**
+     * ROM: how many banks there are
+     */
+    size_t banks = 1;
+
+    /**
+     * MMU: sizes of the pools, in bytes
+     */
+    size_t ram_size = 0;
+    size_t rom_size = 0;
+
+    /**
+     * MMU: the bank windows
+     */
+    std::vector<Window> windows;
+
+    /**
+     * RAM and ROM: what to fill the memory with (all the banks one after the other, for ROM.) MMU:
+     * what to fill the ROM pool with. Empty to leave it blank. Plugins: the library, in the
+     * machine's plugin directory
+     */
+    std::string file;
+
+    /**
+     * Plugins: passed to the plugin as is
+     */
+    std::string options;
+
+    /**
+     * What the processor may do with the device's pages (its windows, for an MMU), PageTable::Permission bits
+     */
+    uint8_t permissions = PageTable::ALL;
+
+    /**
+     * How many addresses the device takes up from its base address, not counting any MMU windows
+     */
+    size_t getAddressSpaceLength() const;
+
+    /**
+     * How much of the emulator's memory arena the device's storage takes up
+     */
+    size_t getArenaSize() const;
+};
+
+/**
+ * The layout of a machine: which devices are where, and where programs are loaded
+ *
+ * Read from an INI file with a group per device, so the same emulator can run different machines.
+ * The default is the one in config/machine.ini, which is also where the format is described
+ */
+struct MachineConfig{
+    /**
+     * The machine used if none is given
+     */
+    static const QString kDefaultPath;
+
+    /**
+     * Where assembled images are loaded
+     */
+    uint16_t program_offset = 0x5f00;
+
+    std::vector<DeviceConfig> devices;
+
+    /**
+     * Read a machine from a config file, checking that it makes sense
+     *
+     * @param path
+     * @param config Filled in with the machine
+     * @param error Set to what's wrong with the file, if anything
+     * @return false if the file can't be read or describes an impossible machine
+     */
+    static bool load(QString path, MachineConfig &config, QString &error);
+};
+
+#endif // MACHINECONFIG_H
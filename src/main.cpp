@@ -6,11 +6,19 @@
 #include <QHeaderView>
 #include <QPushButton>
 #include <QCommandLineParser>
+#include <QScopedPointer>
+#include <QTimer>
 
 #include <iostream>
+#include <cstring>
+#include <cstdio>
 
 #include "emulator.h"
 #include "mainwindow.h"
+#include "headlessrunner.h"
+#include "serialbridge.h"
+#include "glyphrenderer.h"
+#include "log.h"
 
 // The emulator instance
 Emulator *emulator;
@@ -21,10 +29,49 @@ MainWindow *main_window;
 const std::string kApplicationName = "6502 Emulator";
 const std::string kApplicationVersion = "0.1";
 
+/**
+ * Whether we were asked to run without the UI, or to do something that doesn't need it
+ *
+ * This needs to be known before the application object (and so the command line parser) exists
+ */
+bool isHeadless(int argc, char *argv[]){
+    for(int i = 1; i < argc; i++){
+        if(strncmp(argv[i], "--headless", strlen("--headless")) == 0) return true;
+        if(strncmp(argv[i], "--benchmark-glyphs", strlen("--benchmark-glyphs")) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * Connect the serial port to what was asked for on the command line
+ *
+ * @param serial_mode "stdio" or "pty", anything else leaves the serial port to the serial console
+ * @return The bridge, already started, nullptr if there isn't one
+ */
+SerialBridge *openSerialBridge(QString serial_mode){
+    SerialBridge *bridge = nullptr;
+    if(!serial_mode.isEmpty() && emulator -> getSerialPort() == nullptr){
+        Log::Warning() << "This machine has no serial port to connect";
+        return nullptr;
+    }
+    if(serial_mode == "stdio"){
+        bridge = SerialBridge::openStdio(emulator -> getSerialPort());
+    }else if(serial_mode == "pty"){
+        std::string terminal_name;
+        bridge = SerialBridge::openPseudoTerminal(emulator -> getSerialPort(), terminal_name);
+        if(bridge != nullptr) Log::Info() << "Serial port connected to " << QString::fromStdString(terminal_name);
+    }else if(!serial_mode.isEmpty()){
+        Log::Warning() << "Unknown serial port connection " << serial_mode << ", expected stdio or pty";
+    }
+    if(bridge != nullptr) bridge -> start();
+    return bridge;
+}
+
 int main(int argc, char *argv[]){
     // Create application object and set up command line arguments
+    // A headless run shouldn't need a display, so only create a QApplication if we're showing the UI
 
-    QApplication prog(argc, argv);
+    QScopedPointer<QCoreApplication> prog(isHeadless(argc, argv) ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
     QCoreApplication::setApplicationName(QString::fromStdString(kApplicationName));
     QCoreApplication::setApplicationVersion(QString::fromStdString(kApplicationVersion));
 
@@ -33,7 +80,80 @@ int main(int argc, char *argv[]){
     parser.addVersionOption();
     parser.addPositionalArgument("source", QCoreApplication::translate("file", "Source file to open."));
 
-    parser.process(prog);
+    QCommandLineOption headless_option("headless", QCoreApplication::translate("main", "Run the given assembled image without the UI."), "image");
+    QCommandLineOption stats_interval_option("stats-interval", QCoreApplication::translate("main", "How often to print run-time statistics when headless, 0 to only print them at the end."), "milliseconds", "1000");
+    QCommandLineOption run_for_option("run-for", QCoreApplication::translate("main", "How long to run for when headless, 0 to run until killed."), "milliseconds", "0");
+    parser.addOption(headless_option);
+    parser.addOption(stats_interval_option);
+    parser.addOption(run_for_option);
+    QCommandLineOption turbo_option("turbo", QCoreApplication::translate("main", "Run as fast as possible instead of at the target clock speed."));
+    parser.addOption(turbo_option);
+    QCommandLineOption halt_on_brk_option("halt-on-brk", QCoreApplication::translate("main", "Halt the processor on BRK instead of taking the interrupt."));
+    parser.addOption(halt_on_brk_option);
+    QCommandLineOption cycle_stepped_option("cycle-stepped", QCoreApplication::translate("main", "Emulate the processor one bus cycle at a time, for device-accurate timing. Slower."));
+    parser.addOption(cycle_stepped_option);
+    QCommandLineOption serial_option("serial", QCoreApplication::translate("main", "Connect the serial port to stdin and stdout (stdio) or a new pseudo-terminal (pty) instead of the serial console."), "connection");
+    parser.addOption(serial_option);
+    QCommandLineOption benchmark_glyphs_option("benchmark-glyphs", QCoreApplication::translate("main", "Measure how fast each supported display renderer draws glyphs, then quit."));
+    parser.addOption(benchmark_glyphs_option);
+    QCommandLineOption capture_option("capture", QCoreApplication::translate("main", "Write the display to the given file while running headless."), "file");
+    QCommandLineOption capture_interval_option("capture-interval", QCoreApplication::translate("main", "How many bus cycles apart the captured frames are."), "cycles", "16667");
+    QCommandLineOption capture_format_option("capture-format", QCoreApplication::translate("main", "How to write the captured frames: ppm (one P6 image after the other) or raw (24-bit RGB pixels only)."), "format", "ppm");
+    parser.addOption(capture_option);
+    parser.addOption(capture_interval_option);
+    parser.addOption(capture_format_option);
+    QCommandLineOption audio_option("audio", QCoreApplication::translate("main", "Record the sound chip to the given WAV file while running headless."), "file");
+    parser.addOption(audio_option);
+    QCommandLineOption machine_option("machine", QCoreApplication::translate("main", "Build the machine from the given config file instead of the default one."), "file", MachineConfig::kDefaultPath);
+    parser.addOption(machine_option);
+
+    parser.process(*prog);
+
+    if(parser.isSet(benchmark_glyphs_option)){
+        for(GlyphRenderer::Implementation implementation : {GlyphRenderer::SCALAR, GlyphRenderer::SSE2, GlyphRenderer::AVX2}){
+            if(!GlyphRenderer::isSupported(implementation)) continue;
+            double glyphs_per_second = GlyphRenderer::benchmark(implementation, std::chrono::milliseconds(1000));
+            printf("%s: %.1f million glyphs/s\n", GlyphRenderer::implementationName(implementation), glyphs_per_second / 1e6);
+        }
+        return 0;
+    }
+
+    // If we're headless, run the image and skip the UI entirely
+
+    Emulator::CoreMode core_mode = parser.isSet(cycle_stepped_option) ? Emulator::CYCLE_STEPPED : Emulator::INSTRUCTION_STEPPED;
+
+    // Everything runs on the same machine, so find out what it is first
+    MachineConfig machine;
+    QString machine_error;
+    if(!MachineConfig::load(parser.value(machine_option), machine, machine_error)){
+        Log::Critical() << "Could not load the machine: " << machine_error;
+        return 1;
+    }
+
+    if(parser.isSet(headless_option)){
+        emulator = new Emulator(machine, core_mode);
+        emulator -> turbo = parser.isSet(turbo_option);
+        emulator -> get6502() -> SetHaltOnBRK(parser.isSet(halt_on_brk_option));
+        QScopedPointer<SerialBridge> serial_bridge(openSerialBridge(parser.value(serial_option)));
+        // Keep the statistics out of the way of the serial port
+        bool serial_on_stdout = serial_bridge && parser.value(serial_option) == "stdio";
+        HeadlessRunner runner(emulator,
+                              parser.value(headless_option).toStdString(),
+                              parser.value(stats_interval_option).toInt(),
+                              parser.value(run_for_option).toInt(),
+                              serial_on_stdout ? stderr : stdout);
+        if(parser.isSet(capture_option)){
+            runner.setFrameCapture(parser.value(capture_option).toStdString(),
+                                   parser.value(capture_interval_option).toULongLong(),
+                                   parser.value(capture_format_option) == "raw" ? FrameRecorder::RAW : FrameRecorder::PPM);
+        }
+        if(parser.isSet(audio_option)){
+            runner.setAudioCapture(parser.value(audio_option).toStdString());
+        }
+        // Start once the event loop is up
+        QTimer::singleShot(0, &runner, &HeadlessRunner::start);
+        return prog -> exec();
+    }
 
     QStringList args = parser.positionalArguments();
 
@@ -47,7 +167,10 @@ int main(int argc, char *argv[]){
 
     // Create the emulator object first
 
-    emulator = new Emulator();
+    emulator = new Emulator(machine, core_mode);
+    emulator -> turbo = parser.isSet(turbo_option);
+    emulator -> get6502() -> SetHaltOnBRK(parser.isSet(halt_on_brk_option));
+    QScopedPointer<SerialBridge> serial_bridge(openSerialBridge(parser.value(serial_option)));
 
     // Create the main window object
 
@@ -60,5 +183,5 @@ int main(int argc, char *argv[]){
     }
 
     // Run the application
-    return prog.exec();
+    return prog -> exec();
 }
@@ -14,6 +14,8 @@
 #include <QSpinBox>
 #include <QTimer>
 #include <QLineEdit>
+#include <QScreen>
+#include <QKeyEvent>
 
 #include <fstream>
 #include <algorithm>
@@ -58,17 +60,23 @@ void MainWindow::setUpMemoryTable(QTableView *&memory_view){
 }
 
 void MainWindow::updateRegisterTable(QTableWidget *&register_table){
+    // Read the registers straight from the CPU
+    mos6502 *cpu = emulator -> get6502();
+    updateRegisterTable(register_table, cpu -> GetA(), cpu -> GetX(), cpu -> GetY(), cpu -> GetP(), cpu -> GetPC());
+}
+
+void MainWindow::updateRegisterTable(QTableWidget *&register_table, uint8_t A, uint8_t X, uint8_t Y, uint8_t P, uint16_t PC){
 
     // Register format strings
-    QString reg_A_value_string = QString::asprintf("%c%c%c%c%c%c%c%c (0x%02x)" , BYTE_TO_BINARY(emulator->get6502()->GetA()), emulator->get6502()->GetA());
-    QString reg_X_value_string = QString::asprintf("%c%c%c%c%c%c%c%c (0x%02x)" , BYTE_TO_BINARY(emulator->get6502()->GetX()), emulator->get6502()->GetX());
-    QString reg_Y_value_string = QString::asprintf("%c%c%c%c%c%c%c%c (0x%02x)" , BYTE_TO_BINARY(emulator->get6502()->GetY()), emulator->get6502()->GetY());
-    QString reg_SP_value_string = QString::asprintf("%c%c%c%c%c%c%c%c (0x%02x)" , BYTE_TO_BINARY(emulator->get6502()->GetP()), emulator->get6502()->GetP());
+    QString reg_A_value_string = QString::asprintf("%c%c%c%c%c%c%c%c (0x%02x)" , BYTE_TO_BINARY(A), A);
+    QString reg_X_value_string = QString::asprintf("%c%c%c%c%c%c%c%c (0x%02x)" , BYTE_TO_BINARY(X), X);
+    QString reg_Y_value_string = QString::asprintf("%c%c%c%c%c%c%c%c (0x%02x)" , BYTE_TO_BINARY(Y), Y);
+    QString reg_SP_value_string = QString::asprintf("%c%c%c%c%c%c%c%c (0x%02x)" , BYTE_TO_BINARY(P), P);
     QString reg_PC_value_string = QString::asprintf("%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c (0x%04x)" ,
-                                                    BYTE_TO_BINARY(emulator->get6502()->GetPC() % 0xFF00),
-                                                    BYTE_TO_BINARY(emulator->get6502()->GetPC() % 0x00FF),
-                                                    emulator->get6502()->GetPC());
-    QString reg_status_value_string = QString::asprintf("%c%c%c%c%c%c%c%c (0x%02x)" , BYTE_TO_BINARY(emulator->get6502()->GetPC()), emulator->get6502()->GetPC());
+                                                    BYTE_TO_BINARY(PC % 0xFF00),
+                                                    BYTE_TO_BINARY(PC % 0x00FF),
+                                                    PC);
+    QString reg_status_value_string = QString::asprintf("%c%c%c%c%c%c%c%c (0x%02x)" , BYTE_TO_BINARY(PC), PC);
 
 
     if(register_table == nullptr){
@@ -182,6 +190,12 @@ void MainWindow::updateDockTitleControls(bool is_floating){
 void MainWindow::updateDockTitleBuildLog(bool is_floating){
     updateDockTitle(build_log_tab, is_floating);
 }
+void MainWindow::updateDockTitleSerialConsole(bool is_floating){
+    updateDockTitle(serial_console_tab, is_floating);
+}
+void MainWindow::updateDockTitleDisplay(bool is_floating){
+    updateDockTitle(display_tab, is_floating);
+}
 
 // Menu slots
 
@@ -380,6 +394,30 @@ void MainWindow::interruptEmulator(){
     emulator -> interrupt();
 }
 
+void MainWindow::handleRunStateChanged(bool is_running){
+    step_button -> setEnabled(!is_running);
+}
+
+void MainWindow::handleProcessorHalted(uint16_t pc, mos6502::HaltReason reason){
+    QString message = QString::asprintf("Processor halted at $%04x: ", pc) + Emulator::haltReasonToString(reason);
+    if(reason == mos6502::PROTECTION_FAULT) message += " (" + Emulator::protectionFaultToString(emulator -> getProtectionFault()) + ")";
+    Log::Warning() << message;
+    addToBuildLog(message + (emulator -> isRunning() ? ". Reset or interrupt the emulator to continue" : ". Reset the emulator to continue"));
+}
+
+void MainWindow::updateLiveView(){
+    // While stopped the display catches up with memory changes by itself
+    framebuffer_view -> refresh();
+    // Snapshots are only published while running
+    if(!emulator -> isRunning()) return;
+    // Grab the latest snapshot, if there's nothing new there's nothing to update
+    const MachineSnapshot *snapshot = emulator -> getSnapshotBuffer() -> acquire();
+    if(snapshot == nullptr) return;
+    memory_model -> applySnapshot(*snapshot);
+    updateRegisterTable(register_table, snapshot -> A, snapshot -> X, snapshot -> Y, snapshot -> P, snapshot -> PC);
+    framebuffer_view -> applyFrame(snapshot -> frame);
+}
+
 void MainWindow::compileAndLoad(){
     // Check if we saved this file, prompt to save if not
     if(!loaded_files -> at(file_dropdown -> currentIndex()).saved_since_last_edit){
@@ -429,6 +467,9 @@ void MainWindow::compileAndLoad(){
 
     // Load
 
+    // Writing the image goes through the devices, which belong to the run worker while it's running
+    emulator -> interrupt();
+
     // Creat ifstream and buffer to read into and read file
     std::ifstream output_file_input_stream(out_file_name, std::ios::binary);
     char inBuf[emulator -> kMemorySize];
@@ -436,7 +477,7 @@ void MainWindow::compileAndLoad(){
         Log::Warning() << "Could not read assembly output file when loading. rdstate = " << output_file_input_stream.rdstate();
         Log::Warning() << "eofbit = " << std::ifstream::eofbit << ", failbit = " << std::ifstream::failbit << ", badbit = " << std::ifstream::badbit << ", goodbit = " << std::ifstream::goodbit;
     }else{
-        EmulatorHelper::replaceMemory((uint8_t*) inBuf, emulator -> kProgMemOffset, output_file_input_stream.gcount());
+        EmulatorHelper::replaceMemory((uint8_t*) inBuf, emulator -> getProgramOffset(), output_file_input_stream.gcount());
     }
     this -> resetEmulator();
     // Update memory view
@@ -488,6 +529,11 @@ void MainWindow::setUpEmulatorControls(QWidget *&emulator_controls_wrapper){
     clock_speed_value = new QLineEdit();
     real_clock_speed_label = new QLabel(tr("Actual Clock Speed"));
     real_clock_speed_value = new QLabel(tr("Stopped"));
+    instruction_rate_label = new QLabel(tr("Instructions per Second"));
+    instruction_rate_value = new QLabel(tr("Stopped"));
+    input_latency_label = new QLabel(tr("Input Latency"));
+    input_latency_value = new QLabel(tr("None yet"));
+    turbo_checkbox = new QCheckBox(tr("Run as fast as possible"));
 
     // Create the wrapper and the layout
     QGridLayout *emulator_controls_layout = new QGridLayout();
@@ -501,22 +547,42 @@ void MainWindow::setUpEmulatorControls(QWidget *&emulator_controls_wrapper){
     emulator_controls_layout -> addWidget(clock_speed_value, 1, 1, 1, 2);
     emulator_controls_layout -> addWidget(real_clock_speed_label, 2, 0, 1, 1);
     emulator_controls_layout -> addWidget(real_clock_speed_value, 2, 1, 1, 2);
+    emulator_controls_layout -> addWidget(instruction_rate_label, 3, 0, 1, 1);
+    emulator_controls_layout -> addWidget(instruction_rate_value, 3, 1, 1, 2);
+    emulator_controls_layout -> addWidget(input_latency_label, 4, 0, 1, 1);
+    emulator_controls_layout -> addWidget(input_latency_value, 4, 1, 1, 2);
+    emulator_controls_layout -> addWidget(turbo_checkbox, 5, 0, 1, 3);
 
     emulator_controls_wrapper -> setLayout(emulator_controls_layout);
 
     // Set initial actual clock speed value
     clock_speed_value -> setText(clockSpeedDoubleToString(emulator -> clock_speed));
+    turbo_checkbox -> setChecked(emulator -> turbo);
+    clock_speed_value -> setEnabled(!emulator -> turbo);
 
     // Set the actual clock speed value to auto update
     QTimer *clock_speed_refresh_timer = new QTimer(this);
     connect(clock_speed_refresh_timer, &QTimer::timeout, this, &MainWindow::updateRealClockRate);
     clock_speed_refresh_timer -> start(kClockSpeedRefreshMillis);
 
+    // Poll for snapshots to show while the emulator is running, as often as the screen can show them
+    int refresh_rate = kDefaultRefreshRate;
+    if(QGuiApplication::primaryScreen() != nullptr && QGuiApplication::primaryScreen() -> refreshRate() >= 1){
+        refresh_rate = qRound(QGuiApplication::primaryScreen() -> refreshRate());
+    }
+    emulator -> snapshot_rate = refresh_rate;
+    QTimer *live_view_refresh_timer = new QTimer(this);
+    connect(live_view_refresh_timer, &QTimer::timeout, this, &MainWindow::updateLiveView);
+    live_view_refresh_timer -> start(1000 / refresh_rate);
+
     // Bind the emulator controls
     connect(clock_speed_value, &QLineEdit::editingFinished, this, &MainWindow::updateClockRate);
+    connect(turbo_checkbox, &QCheckBox::toggled, this, &MainWindow::updateTurbo);
     connect(step_button, &QPushButton::clicked, this, &MainWindow::emulatorStep);
     connect(run_button, &QPushButton::clicked, emulator, &Emulator::run);
     connect(interrupt_button, &QPushButton::clicked, this, &MainWindow::interruptEmulator);
+    connect(emulator, &Emulator::halted, this, &MainWindow::handleProcessorHalted);
+    connect(emulator, &Emulator::runStateChanged, this, &MainWindow::handleRunStateChanged);
 }
 
 double MainWindow::parseClockSpeedString(std::string clock_speed_string){
@@ -613,7 +679,48 @@ QString MainWindow::clockSpeedDoubleToString(double clock_speed){
 
 void MainWindow::updateRealClockRate(){
     // Get the real clock speed, format it, then set the label in the emulator controls
-    real_clock_speed_value -> setText(clockSpeedDoubleToString(emulator -> real_clock_speed));
+    if(!emulator -> isRunning()){
+        real_clock_speed_value -> setText(tr("Stopped"));
+        instruction_rate_value -> setText(tr("Stopped"));
+        return;
+    }
+    TelemetrySample sample = emulator -> getTelemetry() -> read();
+    real_clock_speed_value -> setText(clockSpeedDoubleToString(sample.effective_clock_speed));
+    // Same for the number of instructions the host gets through per second
+    instruction_rate_value -> setText(QString::number(sample.effective_instruction_rate / 1e6, 'f', 2) + " MIPS");
+    // From a key being typed on the display to the first frame after the program read it
+    if(sample.input_latency_nanos > 0){
+        input_latency_value -> setText(QString::number(sample.input_latency_nanos / 1e6, 'f', 1) + " ms");
+    }
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event){
+    Keyboard *keyboard = emulator -> getKeyboard();
+    if(watched != framebuffer_view || event -> type() != QEvent::KeyPress || keyboard == nullptr) return QMainWindow::eventFilter(watched, event);
+
+    QKeyEvent *key_event = static_cast<QKeyEvent*>(event);
+    uint8_t modifiers = 0;
+    if(key_event -> modifiers() & Qt::ShiftModifier) modifiers |= Keyboard::SHIFT;
+    if(key_event -> modifiers() & Qt::ControlModifier) modifiers |= Keyboard::CONTROL_KEY;
+    if(key_event -> modifiers() & Qt::AltModifier) modifiers |= Keyboard::ALT;
+
+    // Straight into the keyboard's queue, the processor picks it up between instructions
+    switch(key_event -> key()){
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        keyboard -> pushKey('\r', modifiers);
+        return true;
+    case Qt::Key_Backspace:
+        keyboard -> pushKey(0x08, modifiers);
+        return true;
+    case Qt::Key_Escape:
+        keyboard -> pushKey(0x1B, modifiers);
+        return true;
+    }
+    for(QChar character : key_event -> text()){
+        if(character.unicode() < 0x80) keyboard -> pushKey(character.unicode(), modifiers);
+    }
+    return true;
 }
 
 void MainWindow::updateClockRate(){
@@ -626,6 +733,12 @@ void MainWindow::updateClockRate(){
     clock_speed_value -> setText(clockSpeedDoubleToString(emulator -> clock_speed));
 }
 
+void MainWindow::updateTurbo(bool turbo){
+    emulator -> turbo = turbo;
+    // The target clock speed doesn't mean anything while running as fast as possible
+    clock_speed_value -> setEnabled(!turbo);
+}
+
 MainWindow::MainWindow(std::string kWindowTitle, QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
@@ -643,6 +756,8 @@ MainWindow::MainWindow(std::string kWindowTitle, QWidget *parent)
     setUpEditor(editor_container, editor, editor_title);
     setUpBuildLog(build_log);
     setUpEmulatorControls(emulator_controls_wrapper);
+    serial_console = new SerialConsole(emulator -> getSerialPort());
+    framebuffer_view = new FramebufferView(emulator);
 
 
     // Set up the dock widgets
@@ -650,17 +765,27 @@ MainWindow::MainWindow(std::string kWindowTitle, QWidget *parent)
     memory_tab = new QDockWidget("Memory");
     emulator_controls_tab = new QDockWidget("Controls");
     build_log_tab = new QDockWidget("Build Log");
+    serial_console_tab = new QDockWidget("Serial Console");
+    display_tab = new QDockWidget("Display");
 
     emulator_controls_tab -> setWidget(emulator_controls_wrapper);
     memory_tab -> setWidget(memory_view);
     register_tab -> setWidget(register_table);
     build_log_tab -> setWidget(build_log);
+    serial_console_tab -> setWidget(serial_console);
+    display_tab -> setWidget(framebuffer_view);
+
+    // Typing on the display goes to the emulated keyboard
+    framebuffer_view -> setFocusPolicy(Qt::StrongFocus);
+    framebuffer_view -> installEventFilter(this);
 
     // Dock widget title updates
     connect(memory_tab, &QDockWidget::topLevelChanged, this, &MainWindow::updateDockTitleMemory);
     connect(register_tab, &QDockWidget::topLevelChanged, this, &MainWindow::updateDockTitleRegisters);
     connect(emulator_controls_tab, &QDockWidget::topLevelChanged, this, &MainWindow::updateDockTitleControls);
     connect(build_log_tab, &QDockWidget::topLevelChanged, this, &MainWindow::updateDockTitleBuildLog);
+    connect(serial_console_tab, &QDockWidget::topLevelChanged, this, &MainWindow::updateDockTitleSerialConsole);
+    connect(display_tab, &QDockWidget::topLevelChanged, this, &MainWindow::updateDockTitleDisplay);
 
     // Set up menus
 
@@ -714,6 +839,8 @@ MainWindow::MainWindow(std::string kWindowTitle, QWidget *parent)
     this -> addDockWidget(Qt::RightDockWidgetArea, register_tab);
     this -> addDockWidget(Qt::RightDockWidgetArea, emulator_controls_tab);
     this -> addDockWidget(Qt::BottomDockWidgetArea, build_log_tab);
+    this -> addDockWidget(Qt::BottomDockWidgetArea, serial_console_tab);
+    this -> addDockWidget(Qt::RightDockWidgetArea, display_tab);
     this -> addToolBar(tool_bar);
 
     // Set the size for the build log tab
@@ -737,6 +864,11 @@ MainWindow::~MainWindow() {
     delete clock_speed_value;
     delete real_clock_speed_label;
     delete real_clock_speed_value;
+    delete instruction_rate_label;
+    delete instruction_rate_value;
+    delete input_latency_label;
+    delete input_latency_value;
+    delete turbo_checkbox;
     delete emulator_controls_wrapper;
 
     delete editor;
@@ -744,6 +876,8 @@ MainWindow::~MainWindow() {
     delete editor_title;
 
     delete build_log;
+    delete serial_console;
+    delete framebuffer_view;
 
     delete build_button;
 
@@ -751,6 +885,8 @@ MainWindow::~MainWindow() {
     delete register_tab;
     delete emulator_controls_tab;
     delete build_log_tab;
+    delete serial_console_tab;
+    delete display_tab;
 
     delete file_menu;
     delete build_menu;
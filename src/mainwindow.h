@@ -9,11 +9,14 @@
 #include <QToolBar>
 #include <QComboBox>
 #include <QLabel>
+#include <QCheckBox>
 
 #include "loadedfile.h"
 #include "qplaintextedit.h"
 #include "syntaxhighlighter.h"
 #include "memorymodel.h"
+#include "serialconsole.h"
+#include "framebufferview.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -36,12 +39,13 @@ public:
     void updateDockTitleRegisters(bool is_floating);
     void updateDockTitleControls(bool is_floating);
     void updateDockTitleBuildLog(bool is_floating);
+    void updateDockTitleSerialConsole(bool is_floating);
+    void updateDockTitleDisplay(bool is_floating);
 
     /**
-     * Compiles and loads the current file into memory at 0x5F00, sets the reset vector to that address, and resets the emulator
+     * Compiles and loads the current file into memory at the machine's program offset, sets the reset vector to that address, and resets the emulator
      *
      * TODO: Move the positioning in memory to an external script and call that
-     * TODO: Allow custom memory maps
      */
     void compileAndLoad();
 
@@ -103,6 +107,13 @@ public:
      */
     void updateRegisterTable(QTableWidget *&register_table);
 
+    /**
+     * Updates the register view QTableWidget object from the given register values
+     *
+     * @param register_table
+     */
+    void updateRegisterTable(QTableWidget *&register_table, uint8_t A, uint8_t X, uint8_t Y, uint8_t P, uint16_t PC);
+
     /**
      *
      * Sets up the editor
@@ -171,11 +182,38 @@ public:
      */
     void updateClockRate();
 
+    /**
+     * Switches the emulator between running at the target clock speed and running as fast as possible
+     *
+     * @param turbo
+     */
+    void updateTurbo(bool turbo);
+
     /**
      * Interrupt the emulator
      */
     void interruptEmulator();
 
+    /**
+     * Only let the user step the processor while it isn't running, the run worker owns it then
+     *
+     * @param is_running
+     */
+    void handleRunStateChanged(bool is_running);
+
+    /**
+     * Tell the user that the processor halted, while running or stepping
+     *
+     * @param pc The address of the instruction that halted the processor
+     * @param reason
+     */
+    void handleProcessorHalted(uint16_t pc, mos6502::HaltReason reason);
+
+    /**
+     * Picks up the latest snapshot published by the emulator while it is running and updates the memory, register and display views
+     */
+    void updateLiveView();
+
     /**
      * The main window title
      */
@@ -191,6 +229,17 @@ public:
      */
     const int kClockSpeedRefreshMillis = 500;
 
+    /**
+     * How often the live views are refreshed if the screen's refresh rate can't be found out
+     */
+    const int kDefaultRefreshRate = 60;
+
+protected:
+    /**
+     * Sends the keys typed on the display to the emulated keyboard
+     */
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private:
     Ui::MainWindow *ui;
 
@@ -209,6 +258,11 @@ private:
     QLineEdit *clock_speed_value = nullptr;
     QLabel *real_clock_speed_label = nullptr;
     QLabel *real_clock_speed_value = nullptr;
+    QLabel *instruction_rate_label = nullptr;
+    QLabel *instruction_rate_value = nullptr;
+    QLabel *input_latency_label = nullptr;
+    QLabel *input_latency_value = nullptr;
+    QCheckBox *turbo_checkbox = nullptr;
     QWidget *emulator_controls_wrapper = nullptr;
 
 
@@ -220,6 +274,12 @@ private:
     // The build output area
     QPlainTextEdit *build_log = nullptr;
 
+    // The terminal on the serial port
+    SerialConsole *serial_console = nullptr;
+
+    // The video device's display
+    FramebufferView *framebuffer_view = nullptr;
+
     // The build button, unused (TODO: Remove)
     QPushButton *build_button = nullptr;
 
@@ -228,6 +288,8 @@ private:
     QDockWidget *memory_tab = nullptr;
     QDockWidget *emulator_controls_tab = nullptr;
     QDockWidget *build_log_tab = nullptr;
+    QDockWidget *serial_console_tab = nullptr;
+    QDockWidget *display_tab = nullptr;
 
     // The menus
     QMenu *file_menu = nullptr;
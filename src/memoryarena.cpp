@@ -0,0 +1,21 @@
+#include "memoryarena.h"
+
+#include <cstring>
+#include <new>
+
+MemoryArena::MemoryArena(size_t capacity) : capacity{roundUp(capacity)}{
+    memory = (uint8_t*) ::operator new[](this -> capacity, std::align_val_t(kAlignment));
+    memset(memory, 0xFF, this -> capacity);
+}
+
+MemoryArena::~MemoryArena(){
+    ::operator delete[](memory, std::align_val_t(kAlignment));
+}
+
+uint8_t *MemoryArena::allocate(size_t length){
+    size_t footprint = roundUp(length);
+    if(footprint > capacity - used) return nullptr;
+    uint8_t *allocation = memory + used;
+    used += footprint;
+    return allocation;
+}
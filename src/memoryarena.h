@@ -0,0 +1,64 @@
+#ifndef MEMORYARENA_H
+#define MEMORYARENA_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * One block of host memory that every device's storage is carved out of
+ *
+ * The whole machine's memory (RAM, every ROM bank, the MMU's pools) sits in one contiguous, page
+ * aligned region, so a snapshot of it is a single memcpy and comparing two of them is a single
+ * streaming pass. The arena doesn't grow, since devices keep pointers into it, so its size has to be
+ * known up front (see roundUp()). Allocations are only given back all at once, when it's deleted
+ */
+class MemoryArena{
+public:
+    /**
+     * Every allocation starts on a host page
+     */
+    constexpr static size_t kAlignment = 4096;
+
+    /**
+     * How much of the arena an allocation takes up
+     *
+     * @param length
+     * @return length, rounded up to kAlignment
+     */
+    static size_t roundUp(size_t length){
+        return (length + kAlignment - 1) & ~(kAlignment - 1);
+    }
+
+    /**
+     * @param capacity How large the arena is, the sum of roundUp() of everything that will be allocated
+     */
+    MemoryArena(size_t capacity);
+    ~MemoryArena();
+
+    /**
+     * Get storage that lives as long as the arena. It starts out as 0xFF, like blank memory
+     *
+     * @param length
+     * @return The storage, nullptr if the arena doesn't have room for it
+     */
+    uint8_t *allocate(size_t length);
+
+    /**
+     * The start of the arena, everything allocated is between here and getUsedSize() bytes on
+     */
+    uint8_t *getMemory(){return memory;}
+    size_t getUsedSize(){return used;}
+
+    /**
+     * @param pointer
+     * @return whether pointer is in storage the arena gave out
+     */
+    bool contains(const uint8_t *pointer){return pointer >= memory && pointer < memory + used;}
+
+private:
+    uint8_t *memory;
+    const size_t capacity;
+    size_t used = 0;
+};
+
+#endif // MEMORYARENA_H
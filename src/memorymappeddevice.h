@@ -5,6 +5,8 @@
 
 #include <cstdint>
 
+class PageTable;
+
 class MemoryMappedDevice : public QObject{
 
     Q_OBJECT
@@ -29,9 +31,59 @@ public:
      */
     virtual uint8_t getValue(uint16_t address) = 0;
 
+    /**
+     * Gets the value of a register without the side effects a read by
+     * the processor would have (e.g. clearing interrupt flags). Used to
+     * show the memory to the user.
+     *
+     * @param address the address of the register being read, absolute
+     * @return the value of the register
+     */
+    virtual uint8_t peekValue(uint16_t address){return getValue(address);}
+
+    /**
+     * Gets the storage behind an address, for bulk transfers that
+     * don't need to go through getValue() and setValue() one byte at
+     * a time. Only devices that are plain memory, where accesses have
+     * no side effects, hand it out.
+     *
+     * @param address the first address of the transfer, absolute
+     * @param length set to how many bytes from there the pointer covers
+     * @return the storage, nullptr if the device isn't plain memory there
+     */
+    virtual uint8_t *getDirectMemory(uint16_t address, size_t &length){return nullptr;}
+
+    /**
+     * Called once the device is on the bus, with the page table the
+     * bus dispatches through. Devices that are plain memory map their
+     * storage into it so the processor accesses it directly, and keep
+     * it to rewrite their entries when they switch banks.
+     *
+     * @param page_table
+     */
+    virtual void attachPageTable(PageTable *page_table){}
+
     virtual uint16_t getBaseAddress(){return base_address;}
     virtual size_t getAddressSpaceLength(){return address_space_length;}
 
+    /**
+     * Bring the device's internal state up to the given bus cycle.
+     *
+     * Called by the bus right before the processor reads or writes one of
+     * the device's registers, and before any other write to them (from the
+     * memory view or the loader), so devices whose state moves with time
+     * (e.g. a free-running counter) can stay stale in between and catch up
+     * in one step. Only called if `needs_sync` is set.
+     *
+     * @param cycle the current bus cycle, never goes backwards
+     */
+    virtual void sync(uint64_t cycle){}
+
+    /**
+     * @return whether the bus should call sync() before accesses
+     */
+    bool needsSync(){return needs_sync;}
+
     virtual ~MemoryMappedDevice(){};
 
 signals:
@@ -42,6 +94,14 @@ signals:
      */
     void addressChanged(uint16_t address);
 
+    /**
+     * Notify that every value from `first` to `last` (inclusive) changed at once, e.g. on a bank switch
+     *
+     * @param first
+     * @param last
+     */
+    void addressRangeChanged(uint16_t first, uint16_t last);
+
 protected:
 
     MemoryMappedDevice(uint16_t base_address, size_t address_space_length) : base_address{base_address}, address_space_length{address_space_length} {}
@@ -54,6 +114,11 @@ protected:
      * The size of the address space occupied by the device
      */
     const size_t address_space_length;
+
+    /**
+     * Set by devices that want sync() called before the processor accesses them
+     */
+    bool needs_sync = false;
 };
 
 #endif // MEMORYMAPPEDDEVICE_H
@@ -1,5 +1,7 @@
 #include "memorymodel.h"
 
+#include <cstring>
+
 #include "log.h"
 
 #include "QColor"
@@ -9,6 +11,9 @@ MemoryModel::MemoryModel(size_t kMemorySize, Emulator *emulator, QObject *parent
     connect(emulator, &Emulator::instructionRan, this, &MemoryModel::clearHighlight);
     // We need to update the model whenever the memory changes
     connect(emulator, &Emulator::memoryChanged, this, &MemoryModel::handleMemoryChanged);
+    connect(emulator, &Emulator::memoryRangeChanged, this, &MemoryModel::handleMemoryRangeChanged);
+    // Switch between the live view and regular updates when the emulator starts or stops running
+    connect(emulator, &Emulator::runStateChanged, this, &MemoryModel::handleRunStateChanged);
 }
 
 MemoryModel::~MemoryModel(){}
@@ -47,7 +52,7 @@ QVariant MemoryModel::data(const QModelIndex &index, int role) const{
                 // Grab this row's raw data
                 uint8_t line[this -> columnCount() - 1];
                 for(int col = 0; col < this -> columnCount() - 1; col++) {
-                    line[col] = emulator -> getMemoryValue((index.row()) * columnCount() + col);
+                    line[col] = displayedValue((index.row()) * columnCount() + col);
                     // Replace unprintable characters with '.' because QString::fromLatin1 won't
                     if(!isprint(line[col])) line[col] = '.';
                 }
@@ -55,7 +60,7 @@ QVariant MemoryModel::data(const QModelIndex &index, int role) const{
                 return QVariant(QString::fromLatin1((char*) line, (qsizetype) (this -> columnCount() - 1)));
             }else{
                 // Grab memory value and return
-                auto ret = QVariant(QString("%1").arg((emulator -> getMemoryValue((index.row()) * (columnCount() - 1) + index.column())), 2, 16, QLatin1Char('0')));
+                auto ret = QVariant(QString("%1").arg((displayedValue((index.row()) * (columnCount() - 1) + index.column())), 2, 16, QLatin1Char('0')));
                 return ret;
             }
         } else {
@@ -71,7 +76,10 @@ QVariant MemoryModel::data(const QModelIndex &index, int role) const{
     // Background brush role
     if(role == Qt::BackgroundRole){
         // If the cell was newly changed, highlight the cell by painting the background
-        if(std::find(newly_changed_cells.begin(), newly_changed_cells.end(), index) != newly_changed_cells.end()){
+        // The ASCII dump is highlighted if anything in its row was
+        if(index.column() == this -> columnCount() - 1){
+            if(highlighted_rows.test(index.row())) return QColor(Qt::yellow);
+        }else if(isHighlighted(index.row() * (columnCount() - 1) + index.column())){
             return QColor(Qt::yellow);
         }
     }
@@ -81,6 +89,8 @@ QVariant MemoryModel::data(const QModelIndex &index, int role) const{
 }
 
 bool MemoryModel::setData(const QModelIndex &index, const QVariant &value, int role){
+    // Devices' registers are only touched from the thread running the processor while it runs, see flags()
+    if(emulator -> isRunning()) return false;
     // If the user is setting the ASCII dump
     if(index.isValid() && index.column() == this -> columnCount() - 1){
         // Grab the string data
@@ -109,7 +119,9 @@ bool MemoryModel::setData(const QModelIndex &index, const QVariant &value, int r
 }
 
 Qt::ItemFlags MemoryModel::flags(const QModelIndex &index) const{
-    // Items are enabled and editable
+    // Items are enabled, and editable unless the processor is running. Writing a device's registers
+    // schedules events and switches banks, which only the worker thread may do while it's running
+    if(emulator -> isRunning()) return Qt::ItemIsEnabled;
     return Qt::ItemIsEnabled | Qt::ItemIsEditable;
 }
 
@@ -126,21 +138,79 @@ void MemoryModel::updateData(QModelIndex top_left, QModelIndex bottom_right){
 }
 
 void MemoryModel::handleMemoryChanged(uint16_t address){
-    // Get an index to the cell and ASCII dump that was changed
-    int row = address / 0x10;
-    int column = address % 0x10;
-    QModelIndex cell_to_update = this -> index(row, column);
-    QModelIndex dump_to_update = this -> index(row, this -> columnCount() - 1);
-    // Add cell and ASCII dump to the list of newly changed cells
-    this -> newly_changed_cells.push_back(cell_to_update);
-    this -> newly_changed_cells.push_back(dump_to_update);
+    // Mark the cell and its row for highlighting
+    highlighted_cells.set(address);
+    highlighted_rows.set(address / 0x10);
+    // Remember the address so the highlight can be cleared later. Instructions mostly touch
+    // neighbouring addresses (e.g. the stack), so extend the last range if we can
+    if(!highlighted_ranges.empty() && highlighted_ranges.back().end_address + 1 == address){
+        highlighted_ranges.back().end_address = address;
+    }else{
+        highlighted_ranges.push_back(Emulator::AddressRange(address, address));
+    }
     // Update the cell and dump
-    this -> updateData(cell_to_update, cell_to_update);
-    this -> updateData(dump_to_update, dump_to_update);
+    this -> updateAddressRange(address, address);
+}
+
+void MemoryModel::handleMemoryRangeChanged(uint16_t first, uint16_t last){
+    for(int address = first; address <= last; address++){
+        highlighted_cells.set(address);
+        highlighted_rows.set(address / 0x10);
+    }
+    highlighted_ranges.push_back(Emulator::AddressRange(first, last));
+    // One update for all the rows the range spans, dumps included
+    this -> updateData(this -> index(first / 0x10, 0), this -> index(last / 0x10, this -> columnCount() - 1));
 }
 
 void MemoryModel::clearHighlight(){
-    // Clear the highlight requests and update everything
-    newly_changed_cells.clear();
+    // Only the previously highlighted ranges change state, so only update those
+    for(auto const &range : highlighted_ranges){
+        for(int address = range.base_address; address <= range.end_address; address++){
+            highlighted_cells.reset(address);
+            highlighted_rows.reset(address / 0x10);
+        }
+        this -> updateAddressRange(range.base_address, range.end_address);
+    }
+    highlighted_ranges.clear();
+}
+
+bool MemoryModel::isHighlighted(uint16_t address) const{
+    return highlighted_cells.test(address);
+}
+
+void MemoryModel::updateAddressRange(uint16_t first, uint16_t last){
+    // Send one dataChanged per row the range spans, covering the cells in that row and the row's dump
+    for(int row = first / 0x10; row <= last / 0x10; row++){
+        int first_column = (row == first / 0x10) ? first % 0x10 : 0;
+        QModelIndex top_left = this -> index(row, first_column);
+        QModelIndex bottom_right = this -> index(row, this -> columnCount() - 1);
+        this -> updateData(top_left, bottom_right);
+    }
+}
+
+void MemoryModel::applySnapshot(const MachineSnapshot &snapshot){
+    // The first snapshot of a run has nothing to be compared against, update everything
+    bool update_everything = !live_view_active;
+    live_view_active = true;
+
+    // Compare page by page, copy over and repaint only the pages that changed
+    for(size_t page_start = 0; page_start < MachineSnapshot::kMemorySize; page_start += kLiveViewPageSize){
+        if(!update_everything && memcmp(live_memory + page_start, snapshot.memory + page_start, kLiveViewPageSize) == 0) continue;
+        memcpy(live_memory + page_start, snapshot.memory + page_start, kLiveViewPageSize);
+        this -> updateData(this -> index(page_start / 0x10, 0),
+                           this -> index((page_start + kLiveViewPageSize) / 0x10 - 1, this -> columnCount() - 1));
+    }
+}
+
+void MemoryModel::handleRunStateChanged(bool is_running){
+    // Nothing to do until the first snapshot of the run comes in
+    if(is_running) return;
+    // Once stopped, read from the emulator again and refresh everything
+    live_view_active = false;
     this -> updateData();
 }
+
+uint8_t MemoryModel::displayedValue(uint16_t address) const{
+    if(live_view_active) return live_memory[address];
+    return emulator -> getMemoryValue(address);
+}
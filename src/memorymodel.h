@@ -3,6 +3,9 @@
 
 #include <QAbstractListModel>
 
+#include <bitset>
+#include <vector>
+
 #include "emulator.h"
 
 class MemoryModel : public QAbstractTableModel
@@ -34,17 +37,92 @@ public:
     void handleMemoryChanged(uint16_t address);
 
     /**
-     * Clears the `newlyChangedCells vector`
+     * Emits dataChanged() for a range of addresses that changed at once, marks those cells for highlighting
+     *
+     * @param first
+     * @param last
+     */
+    void handleMemoryRangeChanged(uint16_t first, uint16_t last);
+
+    /**
+     * Clears the highlight on the cells affected by the last instruction
+     *
+     * Only the cells that were highlighted are updated, the rest of the table is left alone
      */
     void clearHighlight();
 
     /**
-     * Vector of cells affected by the last instruction
+     * Whether the cell at the given address is highlighted
+     *
+     * @param address
+     * @return
+     */
+    bool isHighlighted(uint16_t address) const;
+
+    /**
+     * Show the memory from a snapshot published while the emulator is running
      *
-     * @brief newlyChangedCells
+     * Only the pages that differ from the previously shown snapshot are updated
+     *
+     * @param snapshot
+     */
+    void applySnapshot(const MachineSnapshot &snapshot);
+
+    /**
+     * Go back to reading the memory from the emulator when it stops running
+     *
+     * @param is_running
      */
-    std::vector<QModelIndex> newly_changed_cells;
+    void handleRunStateChanged(bool is_running);
+
 private:
+    /**
+     * Get the value to display for the given address, from the live view if it's active
+     *
+     * @param address
+     * @return
+     */
+    uint8_t displayedValue(uint16_t address) const;
+
+    /**
+     * Size of the blocks applySnapshot() compares and updates at once
+     */
+    constexpr static size_t kLiveViewPageSize = 0x100;
+
+    /**
+     * Memory contents of the last applied snapshot
+     */
+    uint8_t live_memory[MachineSnapshot::kMemorySize];
+
+    /**
+     * Whether the memory is being displayed from `live_memory` rather than read from the emulator
+     */
+    bool live_view_active = false;
+
+    /**
+     * Emits dataChanged() for the cells from `first` to `last` (inclusive,) and the ASCII dumps of their rows
+     *
+     * @param first
+     * @param last
+     */
+    void updateAddressRange(uint16_t first, uint16_t last);
+
+    /**
+     * One bit per address, set if the cell was changed by the last instruction
+     */
+    std::bitset<Emulator::kMemorySize> highlighted_cells;
+
+    /**
+     * One bit per row, set if any cell in the row is highlighted (the ASCII dump is highlighted then)
+     */
+    std::bitset<Emulator::kMemorySize / 0x10> highlighted_rows;
+
+    /**
+     * Ranges of addresses that are currently highlighted, so clearing the
+     * highlight doesn't need to walk the whole table
+     */
+    std::vector<Emulator::AddressRange> highlighted_ranges;
+
     // The total size of the memory, shouldn't really be a constant here but should be
     // calculated based off the memory devices TODO: Remove
     const size_t kMemorySize;
@@ -0,0 +1,104 @@
+#include "mmu.h"
+
+#include "memoryarena.h"
+#include "pagetable.h"
+
+BankWindow::BankWindow(uint16_t base_address, size_t size, MMU *mmu) : MemoryMappedDevice(base_address, size), mmu{mmu}{
+    selectBank(0);
+}
+
+bool BankWindow::setValue(uint16_t address, uint8_t value){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return false;
+    // ROM and missing banks ignore writes
+    if(bank_memory != nullptr && bank_writable) bank_memory[relative_address] = value;
+    return true;
+}
+
+uint8_t BankWindow::getValue(uint16_t address){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length || bank_memory == nullptr) return 0xFF;
+    return bank_memory[relative_address];
+}
+
+uint8_t *BankWindow::getDirectMemory(uint16_t address, size_t &length){
+    // Bulk writes into ROM have to be ignored like any other, so only RAM is handed out
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length || bank_memory == nullptr || !bank_writable) return nullptr;
+    length = this -> address_space_length - relative_address;
+    return bank_memory + relative_address;
+}
+
+void BankWindow::attachPageTable(PageTable *page_table){
+    this -> page_table = page_table;
+    mapBank();
+}
+
+void BankWindow::selectBank(uint8_t bank){
+    bank_memory = mmu -> findBank(bank, address_space_length, bank_writable);
+    mapBank();
+    // Everything in the window shows something else now
+    emit addressRangeChanged(base_address, base_address + address_space_length - 1);
+}
+
+void BankWindow::mapBank(){
+    if(page_table == nullptr) return;
+    if(bank_memory != nullptr){
+        // Reads come straight from the bank, writes too unless it's ROM
+        page_table -> mapMemory(base_address, address_space_length, bank_memory, bank_writable ? bank_memory : nullptr);
+    }else{
+        page_table -> unmapMemory(base_address, address_space_length);
+    }
+}
+
+MMU::MMU(uint16_t base_address, size_t ram_size, size_t rom_size, MemoryArena *arena) : MemoryMappedDevice(base_address, kRegisterCount),
+                                                                                        ram_size{ram_size},
+                                                                                        rom_size{rom_size}{
+    // The arena hands them out blank
+    ram = arena -> allocate(ram_size);
+    rom = arena -> allocate(rom_size);
+}
+
+BankWindow *MMU::addWindow(uint16_t base_address, size_t size){
+    if(windows.size() >= kMaxWindows) return nullptr;
+    BankWindow *window = new BankWindow(base_address, size, this);
+    windows.push_back(window);
+    return window;
+}
+
+uint8_t *MMU::getROM(){
+    return rom;
+}
+
+size_t MMU::getROMSize(){
+    return rom_size;
+}
+
+bool MMU::setValue(uint16_t address, uint8_t value){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return false;
+
+    registers[relative_address] = value;
+    if(relative_address < windows.size()) windows[relative_address] -> selectBank(value);
+    return true;
+}
+
+uint8_t MMU::getValue(uint16_t address){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+    return registers[relative_address];
+}
+
+uint8_t *MMU::findBank(uint8_t bank, size_t size, bool &writable){
+    // The ROM banks are numbered on from the last whole RAM bank
+    size_t ram_banks = ram_size / size;
+    writable = bank < ram_banks;
+    if(writable) return ram + bank * size;
+    size_t rom_offset = (bank - ram_banks) * size;
+    if(rom_offset + size <= rom_size) return rom + rom_offset;
+    return nullptr;
+}
@@ -0,0 +1,131 @@
+#ifndef MMU_H
+#define MMU_H
+
+#include <vector>
+
+#include "memorymappeddevice.h"
+
+class MemoryArena;
+class PageTable;
+class MMU;
+
+/**
+ * A window in the address space showing one bank of the MMU's pools at a time
+ *
+ * Created by MMU::addWindow(). The bus reads and writes RAM banks straight through the page table,
+ * this device is only used for what isn't plain memory: writes to ROM banks (which are ignored) and
+ * banks past the end of the pools (which read as 0xFF)
+ */
+class BankWindow : public MemoryMappedDevice{
+public:
+    bool setValue(uint16_t address, uint8_t value) override;
+    uint8_t getValue(uint16_t address) override;
+    uint8_t *getDirectMemory(uint16_t address, size_t &length) override;
+    void attachPageTable(PageTable *page_table) override;
+
+    /**
+     * Show a different bank, rewriting our page table entries
+     *
+     * @param bank
+     */
+    void selectBank(uint8_t bank);
+
+private:
+    friend class MMU;
+
+    BankWindow(uint16_t base_address, size_t size, MMU *mmu);
+
+    /**
+     * Point our pages at the current bank
+     */
+    void mapBank();
+
+    MMU *mmu;
+
+    /**
+     * Where the page table is, nullptr until we're on the bus
+     */
+    PageTable *page_table = nullptr;
+
+    /**
+     * The storage of the current bank, nullptr if it's past the end of the pools
+     */
+    uint8_t *bank_memory = nullptr;
+    bool bank_writable = false;
+};
+
+/**
+ * A memory management unit: any number of bank windows (up to kMaxWindows) over a RAM pool and a ROM
+ * pool, much larger than the address space
+ *
+ * Register n selects the bank window n shows. Banks are numbered in units of the window's size, the
+ * RAM pool first and the ROM pool after it, so with 8 KB windows over 64 KB of RAM bank 8 is the
+ * start of the ROM. Switching a bank rewrites the window's page table entries and that's all it costs:
+ * the processor then accesses the bank as plain memory, without any translation
+ */
+class MMU : public MemoryMappedDevice{
+public:
+    /**
+     * How many windows there can be, one register each
+     */
+    constexpr static size_t kMaxWindows = 8;
+
+    /**
+     * Number of registers
+     */
+    constexpr static size_t kRegisterCount = kMaxWindows;
+
+    /**
+     * @param base_address Where the bank registers are
+     * @param ram_size Size of the RAM pool, in bytes
+     * @param rom_size Size of the ROM pool, in bytes
+     * @param arena Where the pools come from
+     */
+    MMU(uint16_t base_address, size_t ram_size, size_t rom_size, MemoryArena *arena);
+
+    /**
+     * Add a window, showing bank 0 to begin with
+     *
+     * The window is a device of its own and has to be added to the bus too, which owns it from then on
+     *
+     * @param base_address Where the window starts, on a page boundary
+     * @param size How large it is, a whole number of pages (e.g. 8 or 16 KB)
+     * @return The window, nullptr if there are kMaxWindows already
+     */
+    BankWindow *addWindow(uint16_t base_address, size_t size);
+
+    /**
+     * The ROM pool, for loading its contents
+     */
+    uint8_t *getROM();
+    size_t getROMSize();
+
+    bool setValue(uint16_t address, uint8_t value) override;
+    uint8_t getValue(uint16_t address) override;
+
+private:
+    friend class BankWindow;
+
+    /**
+     * Find the storage of a bank
+     *
+     * @param bank
+     * @param size The size of the window (and so of the bank)
+     * @param writable Set to whether the bank is RAM
+     * @return The storage, nullptr if the bank is past the end of the pools
+     */
+    uint8_t *findBank(uint8_t bank, size_t size, bool &writable);
+
+    /**
+     * The pools, owned by the arena
+     */
+    uint8_t *ram;
+    const size_t ram_size;
+    uint8_t *rom;
+    const size_t rom_size;
+
+    std::vector<BankWindow*> windows;
+    uint8_t registers[kRegisterCount] = {};
+};
+
+#endif // MMU_H
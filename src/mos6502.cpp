@@ -1,18 +1,39 @@
 
 #include "mos6502.h"
 
-mos6502::mos6502(BusRead r, BusWrite w)
+mos6502::mos6502(BusRead r, BusWrite w, BusRead f)
 {
     Write = (BusWrite)w;
     Read = (BusRead)r;
+    Fetch = f != nullptr ? (BusRead)f : (BusRead)r;
+    instructionCount = 0;
+    interruptCount = 0;
+    extraCycles = 0;
+    noInterrupts = 0;
+    interruptPending = &noInterrupts;
+    halted = false;
+    haltReason = NOT_HALTED;
+    haltPC = 0;
+    opcodePC = 0;
+    haltOnBRK = false;
+    FillInstrTable<false>(InstrTable);
+    FillInstrTable<true>(CycleSteppedInstrTable);
+
+    return;
+}
+
+template<bool cycleStepped>
+void mos6502::FillInstrTable(Instr *table)
+{
     Instr instr;
 
     // fill jump table with ILLEGALs
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_ILLEGAL;
+    instr.cycles = 0;
     for(int i = 0; i < 256; i++)
     {
-        InstrTable[i] = instr;
+        table[i] = instr;
     }
 
     // insert opcodes
@@ -20,668 +41,689 @@ mos6502::mos6502(BusRead r, BusWrite w)
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_ADC;
     instr.cycles = 2;
-    InstrTable[0x69] = instr;
+    table[0x69] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_ADC;
     instr.cycles = 4;
-    InstrTable[0x6D] = instr;
+    table[0x6D] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_ADC;
     instr.cycles = 3;
-    InstrTable[0x65] = instr;
-    instr.addr = &mos6502::Addr_INX;
+    table[0x65] = instr;
+    instr.addr = &mos6502::Addr_INX<cycleStepped>;
     instr.code = &mos6502::Op_ADC;
     instr.cycles = 6;
-    InstrTable[0x61] = instr;
-    instr.addr = &mos6502::Addr_INY;
+    table[0x61] = instr;
+    instr.addr = &mos6502::Addr_INY<true, cycleStepped>;
     instr.code = &mos6502::Op_ADC;
-    instr.cycles = 6;
-    InstrTable[0x71] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
+    instr.cycles = 5;
+    table[0x71] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
     instr.code = &mos6502::Op_ADC;
     instr.cycles = 4;
-    InstrTable[0x75] = instr;
-    instr.addr = &mos6502::Addr_ABX;
+    table[0x75] = instr;
+    instr.addr = &mos6502::Addr_ABX<true, cycleStepped>;
     instr.code = &mos6502::Op_ADC;
     instr.cycles = 4;
-    InstrTable[0x7D] = instr;
-    instr.addr = &mos6502::Addr_ABY;
+    table[0x7D] = instr;
+    instr.addr = &mos6502::Addr_ABY<true, cycleStepped>;
     instr.code = &mos6502::Op_ADC;
     instr.cycles = 4;
-    InstrTable[0x79] = instr;
+    table[0x79] = instr;
 
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_AND;
     instr.cycles = 2;
-    InstrTable[0x29] = instr;
+    table[0x29] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_AND;
     instr.cycles = 4;
-    InstrTable[0x2D] = instr;
+    table[0x2D] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_AND;
     instr.cycles = 3;
-    InstrTable[0x25] = instr;
-    instr.addr = &mos6502::Addr_INX;
+    table[0x25] = instr;
+    instr.addr = &mos6502::Addr_INX<cycleStepped>;
     instr.code = &mos6502::Op_AND;
     instr.cycles = 6;
-    InstrTable[0x21] = instr;
-    instr.addr = &mos6502::Addr_INY;
+    table[0x21] = instr;
+    instr.addr = &mos6502::Addr_INY<true, cycleStepped>;
     instr.code = &mos6502::Op_AND;
     instr.cycles = 5;
-    InstrTable[0x31] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
+    table[0x31] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
     instr.code = &mos6502::Op_AND;
     instr.cycles = 4;
-    InstrTable[0x35] = instr;
-    instr.addr = &mos6502::Addr_ABX;
+    table[0x35] = instr;
+    instr.addr = &mos6502::Addr_ABX<true, cycleStepped>;
     instr.code = &mos6502::Op_AND;
     instr.cycles = 4;
-    InstrTable[0x3D] = instr;
-    instr.addr = &mos6502::Addr_ABY;
+    table[0x3D] = instr;
+    instr.addr = &mos6502::Addr_ABY<true, cycleStepped>;
     instr.code = &mos6502::Op_AND;
     instr.cycles = 4;
-    InstrTable[0x39] = instr;
+    table[0x39] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
-    instr.code = &mos6502::Op_ASL;
+    instr.code = &mos6502::Op_ASL<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x0E] = instr;
+    table[0x0E] = instr;
     instr.addr = &mos6502::Addr_ZER;
-    instr.code = &mos6502::Op_ASL;
+    instr.code = &mos6502::Op_ASL<cycleStepped>;
     instr.cycles = 5;
-    InstrTable[0x06] = instr;
-    instr.addr = &mos6502::Addr_ACC;
+    table[0x06] = instr;
+    instr.addr = &mos6502::Addr_ACC<cycleStepped>;
     instr.code = &mos6502::Op_ASL_ACC;
     instr.cycles = 2;
-    InstrTable[0x0A] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
-    instr.code = &mos6502::Op_ASL;
+    table[0x0A] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
+    instr.code = &mos6502::Op_ASL<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x16] = instr;
-    instr.addr = &mos6502::Addr_ABX;
-    instr.code = &mos6502::Op_ASL;
+    table[0x16] = instr;
+    instr.addr = &mos6502::Addr_ABX<false, cycleStepped>;
+    instr.code = &mos6502::Op_ASL<cycleStepped>;
     instr.cycles = 7;
-    InstrTable[0x1E] = instr;
+    table[0x1E] = instr;
 
     instr.addr = &mos6502::Addr_REL;
-    instr.code = &mos6502::Op_BCC;
+    instr.code = &mos6502::Op_BCC<cycleStepped>;
     instr.cycles = 2;
-    InstrTable[0x90] = instr;
+    table[0x90] = instr;
 
     instr.addr = &mos6502::Addr_REL;
-    instr.code = &mos6502::Op_BCS;
+    instr.code = &mos6502::Op_BCS<cycleStepped>;
     instr.cycles = 2;
-    InstrTable[0xB0] = instr;
+    table[0xB0] = instr;
 
     instr.addr = &mos6502::Addr_REL;
-    instr.code = &mos6502::Op_BEQ;
+    instr.code = &mos6502::Op_BEQ<cycleStepped>;
     instr.cycles = 2;
-    InstrTable[0xF0] = instr;
+    table[0xF0] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_BIT;
     instr.cycles = 4;
-    InstrTable[0x2C] = instr;
+    table[0x2C] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_BIT;
     instr.cycles = 3;
-    InstrTable[0x24] = instr;
+    table[0x24] = instr;
 
     instr.addr = &mos6502::Addr_REL;
-    instr.code = &mos6502::Op_BMI;
+    instr.code = &mos6502::Op_BMI<cycleStepped>;
     instr.cycles = 2;
-    InstrTable[0x30] = instr;
+    table[0x30] = instr;
 
     instr.addr = &mos6502::Addr_REL;
-    instr.code = &mos6502::Op_BNE;
+    instr.code = &mos6502::Op_BNE<cycleStepped>;
     instr.cycles = 2;
-    InstrTable[0xD0] = instr;
+    table[0xD0] = instr;
 
     instr.addr = &mos6502::Addr_REL;
-    instr.code = &mos6502::Op_BPL;
+    instr.code = &mos6502::Op_BPL<cycleStepped>;
     instr.cycles = 2;
-    InstrTable[0x10] = instr;
+    table[0x10] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_BRK;
     instr.cycles = 7;
-    InstrTable[0x00] = instr;
+    table[0x00] = instr;
 
     instr.addr = &mos6502::Addr_REL;
-    instr.code = &mos6502::Op_BVC;
+    instr.code = &mos6502::Op_BVC<cycleStepped>;
     instr.cycles = 2;
-    InstrTable[0x50] = instr;
+    table[0x50] = instr;
 
     instr.addr = &mos6502::Addr_REL;
-    instr.code = &mos6502::Op_BVS;
+    instr.code = &mos6502::Op_BVS<cycleStepped>;
     instr.cycles = 2;
-    InstrTable[0x70] = instr;
+    table[0x70] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_CLC;
     instr.cycles = 2;
-    InstrTable[0x18] = instr;
+    table[0x18] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_CLD;
     instr.cycles = 2;
-    InstrTable[0xD8] = instr;
+    table[0xD8] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_CLI;
     instr.cycles = 2;
-    InstrTable[0x58] = instr;
+    table[0x58] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_CLV;
     instr.cycles = 2;
-    InstrTable[0xB8] = instr;
+    table[0xB8] = instr;
 
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_CMP;
     instr.cycles = 2;
-    InstrTable[0xC9] = instr;
+    table[0xC9] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_CMP;
     instr.cycles = 4;
-    InstrTable[0xCD] = instr;
+    table[0xCD] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_CMP;
     instr.cycles = 3;
-    InstrTable[0xC5] = instr;
-    instr.addr = &mos6502::Addr_INX;
+    table[0xC5] = instr;
+    instr.addr = &mos6502::Addr_INX<cycleStepped>;
     instr.code = &mos6502::Op_CMP;
     instr.cycles = 6;
-    InstrTable[0xC1] = instr;
-    instr.addr = &mos6502::Addr_INY;
+    table[0xC1] = instr;
+    instr.addr = &mos6502::Addr_INY<true, cycleStepped>;
     instr.code = &mos6502::Op_CMP;
-    instr.cycles = 3;
-    InstrTable[0xD1] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
+    instr.cycles = 5;
+    table[0xD1] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
     instr.code = &mos6502::Op_CMP;
     instr.cycles = 4;
-    InstrTable[0xD5] = instr;
-    instr.addr = &mos6502::Addr_ABX;
+    table[0xD5] = instr;
+    instr.addr = &mos6502::Addr_ABX<true, cycleStepped>;
     instr.code = &mos6502::Op_CMP;
     instr.cycles = 4;
-    InstrTable[0xDD] = instr;
-    instr.addr = &mos6502::Addr_ABY;
+    table[0xDD] = instr;
+    instr.addr = &mos6502::Addr_ABY<true, cycleStepped>;
     instr.code = &mos6502::Op_CMP;
     instr.cycles = 4;
-    InstrTable[0xD9] = instr;
+    table[0xD9] = instr;
 
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_CPX;
     instr.cycles = 2;
-    InstrTable[0xE0] = instr;
+    table[0xE0] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_CPX;
     instr.cycles = 4;
-    InstrTable[0xEC] = instr;
+    table[0xEC] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_CPX;
     instr.cycles = 3;
-    InstrTable[0xE4] = instr;
+    table[0xE4] = instr;
 
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_CPY;
     instr.cycles = 2;
-    InstrTable[0xC0] = instr;
+    table[0xC0] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_CPY;
     instr.cycles = 4;
-    InstrTable[0xCC] = instr;
+    table[0xCC] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_CPY;
     instr.cycles = 3;
-    InstrTable[0xC4] = instr;
+    table[0xC4] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
-    instr.code = &mos6502::Op_DEC;
+    instr.code = &mos6502::Op_DEC<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0xCE] = instr;
+    table[0xCE] = instr;
     instr.addr = &mos6502::Addr_ZER;
-    instr.code = &mos6502::Op_DEC;
+    instr.code = &mos6502::Op_DEC<cycleStepped>;
     instr.cycles = 5;
-    InstrTable[0xC6] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
-    instr.code = &mos6502::Op_DEC;
+    table[0xC6] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
+    instr.code = &mos6502::Op_DEC<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0xD6] = instr;
-    instr.addr = &mos6502::Addr_ABX;
-    instr.code = &mos6502::Op_DEC;
+    table[0xD6] = instr;
+    instr.addr = &mos6502::Addr_ABX<false, cycleStepped>;
+    instr.code = &mos6502::Op_DEC<cycleStepped>;
     instr.cycles = 7;
-    InstrTable[0xDE] = instr;
+    table[0xDE] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_DEX;
     instr.cycles = 2;
-    InstrTable[0xCA] = instr;
+    table[0xCA] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_DEY;
     instr.cycles = 2;
-    InstrTable[0x88] = instr;
+    table[0x88] = instr;
 
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_EOR;
     instr.cycles = 2;
-    InstrTable[0x49] = instr;
+    table[0x49] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_EOR;
     instr.cycles = 4;
-    InstrTable[0x4D] = instr;
+    table[0x4D] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_EOR;
     instr.cycles = 3;
-    InstrTable[0x45] = instr;
-    instr.addr = &mos6502::Addr_INX;
+    table[0x45] = instr;
+    instr.addr = &mos6502::Addr_INX<cycleStepped>;
     instr.code = &mos6502::Op_EOR;
     instr.cycles = 6;
-    InstrTable[0x41] = instr;
-    instr.addr = &mos6502::Addr_INY;
+    table[0x41] = instr;
+    instr.addr = &mos6502::Addr_INY<true, cycleStepped>;
     instr.code = &mos6502::Op_EOR;
     instr.cycles = 5;
-    InstrTable[0x51] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
+    table[0x51] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
     instr.code = &mos6502::Op_EOR;
     instr.cycles = 4;
-    InstrTable[0x55] = instr;
-    instr.addr = &mos6502::Addr_ABX;
+    table[0x55] = instr;
+    instr.addr = &mos6502::Addr_ABX<true, cycleStepped>;
     instr.code = &mos6502::Op_EOR;
     instr.cycles = 4;
-    InstrTable[0x5D] = instr;
-    instr.addr = &mos6502::Addr_ABY;
+    table[0x5D] = instr;
+    instr.addr = &mos6502::Addr_ABY<true, cycleStepped>;
     instr.code = &mos6502::Op_EOR;
     instr.cycles = 4;
-    InstrTable[0x59] = instr;
+    table[0x59] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
-    instr.code = &mos6502::Op_INC;
+    instr.code = &mos6502::Op_INC<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0xEE] = instr;
+    table[0xEE] = instr;
     instr.addr = &mos6502::Addr_ZER;
-    instr.code = &mos6502::Op_INC;
+    instr.code = &mos6502::Op_INC<cycleStepped>;
     instr.cycles = 5;
-    InstrTable[0xE6] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
-    instr.code = &mos6502::Op_INC;
+    table[0xE6] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
+    instr.code = &mos6502::Op_INC<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0xF6] = instr;
-    instr.addr = &mos6502::Addr_ABX;
-    instr.code = &mos6502::Op_INC;
+    table[0xF6] = instr;
+    instr.addr = &mos6502::Addr_ABX<false, cycleStepped>;
+    instr.code = &mos6502::Op_INC<cycleStepped>;
     instr.cycles = 7;
-    InstrTable[0xFE] = instr;
+    table[0xFE] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_INX;
     instr.cycles = 2;
-    InstrTable[0xE8] = instr;
+    table[0xE8] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_INY;
     instr.cycles = 2;
-    InstrTable[0xC8] = instr;
+    table[0xC8] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_JMP;
     instr.cycles = 3;
-    InstrTable[0x4C] = instr;
+    table[0x4C] = instr;
     instr.addr = &mos6502::Addr_ABI;
     instr.code = &mos6502::Op_JMP;
     instr.cycles = 5;
-    InstrTable[0x6C] = instr;
+    table[0x6C] = instr;
 
-    instr.addr = &mos6502::Addr_ABS;
-    instr.code = &mos6502::Op_JSR;
+    // cycle stepped JSR only takes the low byte of its target up front, the high byte is read after the pushes
+    instr.addr = cycleStepped ? &mos6502::Addr_IMM : &mos6502::Addr_ABS;
+    instr.code = &mos6502::Op_JSR<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x20] = instr;
+    table[0x20] = instr;
 
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_LDA;
     instr.cycles = 2;
-    InstrTable[0xA9] = instr;
+    table[0xA9] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_LDA;
     instr.cycles = 4;
-    InstrTable[0xAD] = instr;
+    table[0xAD] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_LDA;
     instr.cycles = 3;
-    InstrTable[0xA5] = instr;
-    instr.addr = &mos6502::Addr_INX;
+    table[0xA5] = instr;
+    instr.addr = &mos6502::Addr_INX<cycleStepped>;
     instr.code = &mos6502::Op_LDA;
     instr.cycles = 6;
-    InstrTable[0xA1] = instr;
-    instr.addr = &mos6502::Addr_INY;
+    table[0xA1] = instr;
+    instr.addr = &mos6502::Addr_INY<true, cycleStepped>;
     instr.code = &mos6502::Op_LDA;
     instr.cycles = 5;
-    InstrTable[0xB1] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
+    table[0xB1] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
     instr.code = &mos6502::Op_LDA;
     instr.cycles = 4;
-    InstrTable[0xB5] = instr;
-    instr.addr = &mos6502::Addr_ABX;
+    table[0xB5] = instr;
+    instr.addr = &mos6502::Addr_ABX<true, cycleStepped>;
     instr.code = &mos6502::Op_LDA;
     instr.cycles = 4;
-    InstrTable[0xBD] = instr;
-    instr.addr = &mos6502::Addr_ABY;
+    table[0xBD] = instr;
+    instr.addr = &mos6502::Addr_ABY<true, cycleStepped>;
     instr.code = &mos6502::Op_LDA;
     instr.cycles = 4;
-    InstrTable[0xB9] = instr;
+    table[0xB9] = instr;
 
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_LDX;
     instr.cycles = 2;
-    InstrTable[0xA2] = instr;
+    table[0xA2] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_LDX;
     instr.cycles = 4;
-    InstrTable[0xAE] = instr;
+    table[0xAE] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_LDX;
     instr.cycles = 3;
-    InstrTable[0xA6] = instr;
-    instr.addr = &mos6502::Addr_ABY;
+    table[0xA6] = instr;
+    instr.addr = &mos6502::Addr_ABY<true, cycleStepped>;
     instr.code = &mos6502::Op_LDX;
     instr.cycles = 4;
-    InstrTable[0xBE] = instr;
-    instr.addr = &mos6502::Addr_ZEY;
+    table[0xBE] = instr;
+    instr.addr = &mos6502::Addr_ZEY<cycleStepped>;
     instr.code = &mos6502::Op_LDX;
     instr.cycles = 4;
-    InstrTable[0xB6] = instr;
+    table[0xB6] = instr;
 
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_LDY;
     instr.cycles = 2;
-    InstrTable[0xA0] = instr;
+    table[0xA0] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_LDY;
     instr.cycles = 4;
-    InstrTable[0xAC] = instr;
+    table[0xAC] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_LDY;
     instr.cycles = 3;
-    InstrTable[0xA4] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
+    table[0xA4] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
     instr.code = &mos6502::Op_LDY;
     instr.cycles = 4;
-    InstrTable[0xB4] = instr;
-    instr.addr = &mos6502::Addr_ABX;
+    table[0xB4] = instr;
+    instr.addr = &mos6502::Addr_ABX<true, cycleStepped>;
     instr.code = &mos6502::Op_LDY;
     instr.cycles = 4;
-    InstrTable[0xBC] = instr;
+    table[0xBC] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
-    instr.code = &mos6502::Op_LSR;
+    instr.code = &mos6502::Op_LSR<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x4E] = instr;
+    table[0x4E] = instr;
     instr.addr = &mos6502::Addr_ZER;
-    instr.code = &mos6502::Op_LSR;
+    instr.code = &mos6502::Op_LSR<cycleStepped>;
     instr.cycles = 5;
-    InstrTable[0x46] = instr;
-    instr.addr = &mos6502::Addr_ACC;
+    table[0x46] = instr;
+    instr.addr = &mos6502::Addr_ACC<cycleStepped>;
     instr.code = &mos6502::Op_LSR_ACC;
     instr.cycles = 2;
-    InstrTable[0x4A] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
-    instr.code = &mos6502::Op_LSR;
+    table[0x4A] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
+    instr.code = &mos6502::Op_LSR<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x56] = instr;
-    instr.addr = &mos6502::Addr_ABX;
-    instr.code = &mos6502::Op_LSR;
+    table[0x56] = instr;
+    instr.addr = &mos6502::Addr_ABX<false, cycleStepped>;
+    instr.code = &mos6502::Op_LSR<cycleStepped>;
     instr.cycles = 7;
-    InstrTable[0x5E] = instr;
+    table[0x5E] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_NOP;
     instr.cycles = 2;
-    InstrTable[0xEA] = instr;
+    table[0xEA] = instr;
 
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_ORA;
     instr.cycles = 2;
-    InstrTable[0x09] = instr;
+    table[0x09] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_ORA;
     instr.cycles = 4;
-    InstrTable[0x0D] = instr;
+    table[0x0D] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_ORA;
     instr.cycles = 3;
-    InstrTable[0x05] = instr;
-    instr.addr = &mos6502::Addr_INX;
+    table[0x05] = instr;
+    instr.addr = &mos6502::Addr_INX<cycleStepped>;
     instr.code = &mos6502::Op_ORA;
     instr.cycles = 6;
-    InstrTable[0x01] = instr;
-    instr.addr = &mos6502::Addr_INY;
+    table[0x01] = instr;
+    instr.addr = &mos6502::Addr_INY<true, cycleStepped>;
     instr.code = &mos6502::Op_ORA;
     instr.cycles = 5;
-    InstrTable[0x11] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
+    table[0x11] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
     instr.code = &mos6502::Op_ORA;
     instr.cycles = 4;
-    InstrTable[0x15] = instr;
-    instr.addr = &mos6502::Addr_ABX;
+    table[0x15] = instr;
+    instr.addr = &mos6502::Addr_ABX<true, cycleStepped>;
     instr.code = &mos6502::Op_ORA;
     instr.cycles = 4;
-    InstrTable[0x1D] = instr;
-    instr.addr = &mos6502::Addr_ABY;
+    table[0x1D] = instr;
+    instr.addr = &mos6502::Addr_ABY<true, cycleStepped>;
     instr.code = &mos6502::Op_ORA;
     instr.cycles = 4;
-    InstrTable[0x19] = instr;
+    table[0x19] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_PHA;
     instr.cycles = 3;
-    InstrTable[0x48] = instr;
+    table[0x48] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_PHP;
     instr.cycles = 3;
-    InstrTable[0x08] = instr;
+    table[0x08] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
-    instr.code = &mos6502::Op_PLA;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
+    instr.code = &mos6502::Op_PLA<cycleStepped>;
     instr.cycles = 4;
-    InstrTable[0x68] = instr;
+    table[0x68] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
-    instr.code = &mos6502::Op_PLP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
+    instr.code = &mos6502::Op_PLP<cycleStepped>;
     instr.cycles = 4;
-    InstrTable[0x28] = instr;
+    table[0x28] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
-    instr.code = &mos6502::Op_ROL;
+    instr.code = &mos6502::Op_ROL<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x2E] = instr;
+    table[0x2E] = instr;
     instr.addr = &mos6502::Addr_ZER;
-    instr.code = &mos6502::Op_ROL;
+    instr.code = &mos6502::Op_ROL<cycleStepped>;
     instr.cycles = 5;
-    InstrTable[0x26] = instr;
-    instr.addr = &mos6502::Addr_ACC;
+    table[0x26] = instr;
+    instr.addr = &mos6502::Addr_ACC<cycleStepped>;
     instr.code = &mos6502::Op_ROL_ACC;
     instr.cycles = 2;
-    InstrTable[0x2A] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
-    instr.code = &mos6502::Op_ROL;
+    table[0x2A] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
+    instr.code = &mos6502::Op_ROL<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x36] = instr;
-    instr.addr = &mos6502::Addr_ABX;
-    instr.code = &mos6502::Op_ROL;
+    table[0x36] = instr;
+    instr.addr = &mos6502::Addr_ABX<false, cycleStepped>;
+    instr.code = &mos6502::Op_ROL<cycleStepped>;
     instr.cycles = 7;
-    InstrTable[0x3E] = instr;
+    table[0x3E] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
-    instr.code = &mos6502::Op_ROR;
+    instr.code = &mos6502::Op_ROR<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x6E] = instr;
+    table[0x6E] = instr;
     instr.addr = &mos6502::Addr_ZER;
-    instr.code = &mos6502::Op_ROR;
+    instr.code = &mos6502::Op_ROR<cycleStepped>;
     instr.cycles = 5;
-    InstrTable[0x66] = instr;
-    instr.addr = &mos6502::Addr_ACC;
+    table[0x66] = instr;
+    instr.addr = &mos6502::Addr_ACC<cycleStepped>;
     instr.code = &mos6502::Op_ROR_ACC;
     instr.cycles = 2;
-    InstrTable[0x6A] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
-    instr.code = &mos6502::Op_ROR;
+    table[0x6A] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
+    instr.code = &mos6502::Op_ROR<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x76] = instr;
-    instr.addr = &mos6502::Addr_ABX;
-    instr.code = &mos6502::Op_ROR;
+    table[0x76] = instr;
+    instr.addr = &mos6502::Addr_ABX<false, cycleStepped>;
+    instr.code = &mos6502::Op_ROR<cycleStepped>;
     instr.cycles = 7;
-    InstrTable[0x7E] = instr;
+    table[0x7E] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
-    instr.code = &mos6502::Op_RTI;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
+    instr.code = &mos6502::Op_RTI<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x40] = instr;
+    table[0x40] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
-    instr.code = &mos6502::Op_RTS;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
+    instr.code = &mos6502::Op_RTS<cycleStepped>;
     instr.cycles = 6;
-    InstrTable[0x60] = instr;
+    table[0x60] = instr;
 
     instr.addr = &mos6502::Addr_IMM;
     instr.code = &mos6502::Op_SBC;
     instr.cycles = 2;
-    InstrTable[0xE9] = instr;
+    table[0xE9] = instr;
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_SBC;
     instr.cycles = 4;
-    InstrTable[0xED] = instr;
+    table[0xED] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_SBC;
     instr.cycles = 3;
-    InstrTable[0xE5] = instr;
-    instr.addr = &mos6502::Addr_INX;
+    table[0xE5] = instr;
+    instr.addr = &mos6502::Addr_INX<cycleStepped>;
     instr.code = &mos6502::Op_SBC;
     instr.cycles = 6;
-    InstrTable[0xE1] = instr;
-    instr.addr = &mos6502::Addr_INY;
+    table[0xE1] = instr;
+    instr.addr = &mos6502::Addr_INY<true, cycleStepped>;
     instr.code = &mos6502::Op_SBC;
     instr.cycles = 5;
-    InstrTable[0xF1] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
+    table[0xF1] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
     instr.code = &mos6502::Op_SBC;
     instr.cycles = 4;
-    InstrTable[0xF5] = instr;
-    instr.addr = &mos6502::Addr_ABX;
+    table[0xF5] = instr;
+    instr.addr = &mos6502::Addr_ABX<true, cycleStepped>;
     instr.code = &mos6502::Op_SBC;
     instr.cycles = 4;
-    InstrTable[0xFD] = instr;
-    instr.addr = &mos6502::Addr_ABY;
+    table[0xFD] = instr;
+    instr.addr = &mos6502::Addr_ABY<true, cycleStepped>;
     instr.code = &mos6502::Op_SBC;
     instr.cycles = 4;
-    InstrTable[0xF9] = instr;
+    table[0xF9] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_SEC;
     instr.cycles = 2;
-    InstrTable[0x38] = instr;
+    table[0x38] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_SED;
     instr.cycles = 2;
-    InstrTable[0xF8] = instr;
+    table[0xF8] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_SEI;
     instr.cycles = 2;
-    InstrTable[0x78] = instr;
+    table[0x78] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_STA;
     instr.cycles = 4;
-    InstrTable[0x8D] = instr;
+    table[0x8D] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_STA;
     instr.cycles = 3;
-    InstrTable[0x85] = instr;
-    instr.addr = &mos6502::Addr_INX;
+    table[0x85] = instr;
+    instr.addr = &mos6502::Addr_INX<cycleStepped>;
     instr.code = &mos6502::Op_STA;
     instr.cycles = 6;
-    InstrTable[0x81] = instr;
-    instr.addr = &mos6502::Addr_INY;
+    table[0x81] = instr;
+    instr.addr = &mos6502::Addr_INY<false, cycleStepped>;
     instr.code = &mos6502::Op_STA;
     instr.cycles = 6;
-    InstrTable[0x91] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
+    table[0x91] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
     instr.code = &mos6502::Op_STA;
     instr.cycles = 4;
-    InstrTable[0x95] = instr;
-    instr.addr = &mos6502::Addr_ABX;
+    table[0x95] = instr;
+    instr.addr = &mos6502::Addr_ABX<false, cycleStepped>;
     instr.code = &mos6502::Op_STA;
     instr.cycles = 5;
-    InstrTable[0x9D] = instr;
-    instr.addr = &mos6502::Addr_ABY;
+    table[0x9D] = instr;
+    instr.addr = &mos6502::Addr_ABY<false, cycleStepped>;
     instr.code = &mos6502::Op_STA;
     instr.cycles = 5;
-    InstrTable[0x99] = instr;
+    table[0x99] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_STX;
     instr.cycles = 4;
-    InstrTable[0x8E] = instr;
+    table[0x8E] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_STX;
     instr.cycles = 3;
-    InstrTable[0x86] = instr;
-    instr.addr = &mos6502::Addr_ZEY;
+    table[0x86] = instr;
+    instr.addr = &mos6502::Addr_ZEY<cycleStepped>;
     instr.code = &mos6502::Op_STX;
     instr.cycles = 4;
-    InstrTable[0x96] = instr;
+    table[0x96] = instr;
 
     instr.addr = &mos6502::Addr_ABS;
     instr.code = &mos6502::Op_STY;
     instr.cycles = 4;
-    InstrTable[0x8C] = instr;
+    table[0x8C] = instr;
     instr.addr = &mos6502::Addr_ZER;
     instr.code = &mos6502::Op_STY;
     instr.cycles = 3;
-    InstrTable[0x84] = instr;
-    instr.addr = &mos6502::Addr_ZEX;
+    table[0x84] = instr;
+    instr.addr = &mos6502::Addr_ZEX<cycleStepped>;
     instr.code = &mos6502::Op_STY;
     instr.cycles = 4;
-    InstrTable[0x94] = instr;
+    table[0x94] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_TAX;
     instr.cycles = 2;
-    InstrTable[0xAA] = instr;
+    table[0xAA] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_TAY;
     instr.cycles = 2;
-    InstrTable[0xA8] = instr;
+    table[0xA8] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_TSX;
     instr.cycles = 2;
-    InstrTable[0xBA] = instr;
+    table[0xBA] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_TXA;
     instr.cycles = 2;
-    InstrTable[0x8A] = instr;
+    table[0x8A] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_TXS;
     instr.cycles = 2;
-    InstrTable[0x9A] = instr;
+    table[0x9A] = instr;
 
-    instr.addr = &mos6502::Addr_IMP;
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
     instr.code = &mos6502::Op_TYA;
     instr.cycles = 2;
-    InstrTable[0x98] = instr;
+    table[0x98] = instr;
+
+    // the NMOS KIL/JAM opcodes lock up the processor until reset
+    instr.addr = &mos6502::Addr_IMP<cycleStepped>;
+    instr.code = &mos6502::Op_STP;
+    instr.cycles = 0;
+    table[0x02] = instr;
+    table[0x12] = instr;
+    table[0x22] = instr;
+    table[0x32] = instr;
+    table[0x42] = instr;
+    table[0x52] = instr;
+    table[0x62] = instr;
+    table[0x72] = instr;
+    table[0x92] = instr;
+    table[0xB2] = instr;
+    table[0xD2] = instr;
+    table[0xF2] = instr;
 
     return;
 }
 
+template<bool cycleStepped>
 uint16_t mos6502::Addr_ACC()
 {
+    // the processor reads the next byte anyway and throws it away
+    if constexpr (cycleStepped) Read(pc);
     return 0; // not used
 }
 
@@ -709,8 +751,10 @@ uint16_t mos6502::Addr_ZER()
     return Read(pc++);
 }
 
+template<bool cycleStepped>
 uint16_t mos6502::Addr_IMP()
 {
+    if constexpr (cycleStepped) Read(pc);
     return 0; // not used
 }
 
@@ -752,18 +796,26 @@ uint16_t mos6502::Addr_ABI()
     return addr;
 }
 
+template<bool cycleStepped>
 uint16_t mos6502::Addr_ZEX()
 {
-    uint16_t addr = (Read(pc++) + X) % 256;
+    uint8_t base = Read(pc++);
+    // the base address is read while the index is added
+    if constexpr (cycleStepped) Read(base);
+    uint16_t addr = (base + X) % 256;
     return addr;
 }
 
+template<bool cycleStepped>
 uint16_t mos6502::Addr_ZEY()
 {
-    uint16_t addr = (Read(pc++) + Y) % 256;
+    uint8_t base = Read(pc++);
+    if constexpr (cycleStepped) Read(base);
+    uint16_t addr = (base + Y) % 256;
     return addr;
 }
 
+template<bool pageCrossPenalty, bool cycleStepped>
 uint16_t mos6502::Addr_ABX()
 {
     uint16_t addr;
@@ -774,9 +826,13 @@ uint16_t mos6502::Addr_ABX()
     addrH = Read(pc++);
 
     addr = addrL + (addrH << 8) + X;
+    // the carry out of the low byte is the page crossing
+    if constexpr (pageCrossPenalty) extraCycles += (addrL + X) >> 8;
+    if constexpr (cycleStepped) IndexedDummyRead<pageCrossPenalty>(addrH, addrL + X);
     return addr;
 }
 
+template<bool pageCrossPenalty, bool cycleStepped>
 uint16_t mos6502::Addr_ABY()
 {
     uint16_t addr;
@@ -787,36 +843,72 @@ uint16_t mos6502::Addr_ABY()
     addrH = Read(pc++);
 
     addr = addrL + (addrH << 8) + Y;
+    if constexpr (pageCrossPenalty) extraCycles += (addrL + Y) >> 8;
+    if constexpr (cycleStepped) IndexedDummyRead<pageCrossPenalty>(addrH, addrL + Y);
     return addr;
 }
 
 
+template<bool cycleStepped>
 uint16_t mos6502::Addr_INX()
 {
+    uint8_t base;
     uint16_t zeroL;
     uint16_t zeroH;
     uint16_t addr;
 
-    zeroL = (Read(pc++) + X) % 256;
+    base = Read(pc++);
+    if constexpr (cycleStepped) Read(base);
+    zeroL = (base + X) % 256;
     zeroH = (zeroL + 1) % 256;
     addr = Read(zeroL) + (Read(zeroH) << 8);
 
     return addr;
 }
 
+template<bool pageCrossPenalty, bool cycleStepped>
 uint16_t mos6502::Addr_INY()
 {
     uint16_t zeroL;
     uint16_t zeroH;
+    uint16_t addrL;
+    uint16_t addrH;
     uint16_t addr;
 
     zeroL = Read(pc++);
     zeroH = (zeroL + 1) % 256;
-    addr = Read(zeroL) + (Read(zeroH) << 8) + Y;
+    addrL = Read(zeroL);
+    addrH = Read(zeroH);
+    addr = addrL + (addrH << 8) + Y;
+    if constexpr (pageCrossPenalty) extraCycles += (addrL + Y) >> 8;
+    if constexpr (cycleStepped) IndexedDummyRead<pageCrossPenalty>(addrH, addrL + Y);
 
     return addr;
 }
 
+template<bool pageCrossPenalty>
+void mos6502::IndexedDummyRead(uint16_t addrH, uint16_t indexedL)
+{
+    // the index is added to the low byte first, so the processor reads from the
+    // address without the carry before it fixes up the high byte. reads that
+    // don't cross a page are done by then and skip it
+    if (!pageCrossPenalty || (indexedL >> 8)) Read((addrH << 8) | (indexedL & 0xFF));
+}
+
+template<bool cycleStepped>
+void mos6502::Branch(uint16_t target)
+{
+    extraCycles += 1 + ((pc ^ target) > 0xFF);
+    if constexpr (cycleStepped)
+    {
+        // taking the branch reads the next opcode, and crossing a page reads
+        // from the target before the high byte is fixed up
+        Read(pc);
+        if ((pc ^ target) > 0xFF) Read((pc & 0xFF00) | (target & 0x00FF));
+    }
+    pc = target;
+}
+
 void mos6502::Reset()
 {
     A = reset_A;
@@ -829,7 +921,11 @@ void mos6502::Reset()
 
     status = reset_status | CONSTANT | BREAK;
 
-    illegalOpcode = false;
+    halted = false;
+    haltReason = NOT_HALTED;
+
+    // an NMI edge from before the reset is lost
+    interruptPending->fetch_and(~NMI_PENDING, std::memory_order_relaxed);
 
     return;
 }
@@ -858,10 +954,34 @@ void mos6502::IRQ()
         StackPush((status & ~BREAK) | CONSTANT);
         SET_INTERRUPT(1);
         pc = (Read(irqVectorH) << 8) + Read(irqVectorL);
+        interruptCount++;
     }
     return;
 }
 
+void mos6502::SetInterruptPending(std::atomic<uint32_t> *pending)
+{
+    interruptPending = pending != nullptr ? pending : &noInterrupts;
+}
+
+template<bool cycleStepped>
+uint8_t mos6502::ServiceInterrupts(uint32_t pending)
+{
+    // NMI wins over IRQ, and can't be masked
+    if (pending & NMI_PENDING)
+    {
+        interruptPending->fetch_and(~NMI_PENDING, std::memory_order_relaxed);
+        // the processor reads the next opcode twice before it pushes
+        if constexpr (cycleStepped) { Read(pc); Read(pc); }
+        NMI();
+        return 7;
+    }
+    if (IF_INTERRUPT()) return 0;
+    if constexpr (cycleStepped) { Read(pc); Read(pc); }
+    IRQ();
+    return 7;
+}
+
 void mos6502::NMI()
 {
     //SET_BREAK(0);
@@ -870,6 +990,7 @@ void mos6502::NMI()
     StackPush((status & ~BREAK) | CONSTANT);
     SET_INTERRUPT(1);
     pc = (Read(nmiVectorH) << 8) + Read(nmiVectorL);
+    interruptCount++;
     return;
 }
 
@@ -881,19 +1002,64 @@ void mos6502::Run(
     uint8_t opcode;
     Instr instr;
 
-    while(cyclesRemaining > 0 && !illegalOpcode)
+    while(cyclesRemaining > 0 && !halted)
     {
+        // interrupts
+        uint32_t pending = interruptPending->load(std::memory_order_relaxed);
+        if (pending)
+        {
+            uint8_t interruptCycles = ServiceInterrupts<false>(pending);
+            cycleCount += interruptCycles;
+            if (cycleMethod == CYCLE_COUNT) cyclesRemaining -= interruptCycles;
+        }
+
         // fetch
-        opcode = Read(pc++);
+        opcodePC = pc;
+        opcode = Fetch(pc++);
 
         // decode
         instr = InstrTable[opcode];
 
         // execute
+        extraCycles = 0;
+        Exec(instr);
+        instructionCount++;
+        cycleCount += instr.cycles + extraCycles;
+        cyclesRemaining -=
+            cycleMethod == CYCLE_COUNT        ? instr.cycles + extraCycles
+            /* cycleMethod == INST_COUNT */   : 1;
+    }
+}
+
+void mos6502::RunCycleStepped(
+    int32_t cyclesRemaining,
+    uint64_t& cycleCount,
+    CycleMethod cycleMethod
+) {
+    uint8_t opcode;
+    Instr instr;
+
+    // same as Run(), but every cycle of every instruction is a bus access
+    while(cyclesRemaining > 0 && !halted)
+    {
+        uint32_t pending = interruptPending->load(std::memory_order_relaxed);
+        if (pending)
+        {
+            uint8_t interruptCycles = ServiceInterrupts<true>(pending);
+            cycleCount += interruptCycles;
+            if (cycleMethod == CYCLE_COUNT) cyclesRemaining -= interruptCycles;
+        }
+
+        opcodePC = pc;
+        opcode = Fetch(pc++);
+        instr = CycleSteppedInstrTable[opcode];
+
+        extraCycles = 0;
         Exec(instr);
-        cycleCount += instr.cycles;
+        instructionCount++;
+        cycleCount += instr.cycles + extraCycles;
         cyclesRemaining -=
-            cycleMethod == CYCLE_COUNT        ? instr.cycles
+            cycleMethod == CYCLE_COUNT        ? instr.cycles + extraCycles
             /* cycleMethod == INST_COUNT */   : 1;
     }
 }
@@ -934,6 +1100,50 @@ uint8_t mos6502::GetY()
     return Y;
 }
 
+uint64_t mos6502::GetInstructionCount()
+{
+    return instructionCount;
+}
+
+uint64_t mos6502::GetInterruptCount()
+{
+    return interruptCount;
+}
+
+bool mos6502::IsHalted()
+{
+    return halted;
+}
+
+mos6502::HaltReason mos6502::GetHaltReason()
+{
+    return (HaltReason)haltReason;
+}
+
+uint16_t mos6502::GetHaltPC()
+{
+    return haltPC;
+}
+
+void mos6502::Trap(HaltReason reason)
+{
+    // the first fault is the one that counts
+    if (halted) return;
+    haltPC = opcodePC;
+    haltReason = reason;
+    halted = true;
+}
+
+void mos6502::SetHaltOnBRK(bool value)
+{
+    haltOnBRK = value;
+}
+
+bool mos6502::GetHaltOnBRK()
+{
+    return haltOnBRK;
+}
+
 void mos6502::SetResetS(uint8_t value)
 {
     reset_sp = value;
@@ -984,9 +1194,25 @@ uint8_t mos6502::GetResetY()
     return reset_Y;
 }
 
+void mos6502::Halt(uint8_t reason)
+{
+    // a fault earlier in the instruction has already halted it
+    if (halted) return;
+    // leave pc on the instruction that halted
+    pc--;
+    haltPC = pc;
+    haltReason = reason;
+    halted = true;
+}
+
 void mos6502::Op_ILLEGAL(uint16_t src)
 {
-    illegalOpcode = true;
+    Halt(ILLEGAL_OPCODE);
+}
+
+void mos6502::Op_STP(uint16_t src)
+{
+    Halt(STOP_INSTRUCTION);
 }
 
 
@@ -1030,9 +1256,12 @@ void mos6502::Op_AND(uint16_t src)
 }
 
 
+template<bool cycleStepped>
 void mos6502::Op_ASL(uint16_t src)
 {
     uint8_t m = Read(src);
+    // read-modify-write instructions write the unmodified value back first
+    if constexpr (cycleStepped) Write(src, m);
     SET_CARRY(m & 0x80);
     m <<= 1;
     m &= 0xFF;
@@ -1054,30 +1283,33 @@ void mos6502::Op_ASL_ACC(uint16_t src)
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_BCC(uint16_t src)
 {
     if (!IF_CARRY())
     {
-        pc = src;
+        Branch<cycleStepped>(src);
     }
     return;
 }
 
 
+template<bool cycleStepped>
 void mos6502::Op_BCS(uint16_t src)
 {
     if (IF_CARRY())
     {
-        pc = src;
+        Branch<cycleStepped>(src);
     }
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_BEQ(uint16_t src)
 {
     if (IF_ZERO())
     {
-        pc = src;
+        Branch<cycleStepped>(src);
     }
     return;
 }
@@ -1092,35 +1324,43 @@ void mos6502::Op_BIT(uint16_t src)
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_BMI(uint16_t src)
 {
     if (IF_NEGATIVE())
     {
-        pc = src;
+        Branch<cycleStepped>(src);
     }
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_BNE(uint16_t src)
 {
     if (!IF_ZERO())
     {
-        pc = src;
+        Branch<cycleStepped>(src);
     }
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_BPL(uint16_t src)
 {
     if (!IF_NEGATIVE())
     {
-        pc = src;
+        Branch<cycleStepped>(src);
     }
     return;
 }
 
 void mos6502::Op_BRK(uint16_t src)
 {
+    if (haltOnBRK)
+    {
+        Halt(BREAK_TRAP);
+        return;
+    }
     pc++;
     StackPush((pc >> 8) & 0xFF);
     StackPush(pc & 0xFF);
@@ -1130,20 +1370,22 @@ void mos6502::Op_BRK(uint16_t src)
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_BVC(uint16_t src)
 {
     if (!IF_OVERFLOW())
     {
-        pc = src;
+        Branch<cycleStepped>(src);
     }
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_BVS(uint16_t src)
 {
     if (IF_OVERFLOW())
     {
-        pc = src;
+        Branch<cycleStepped>(src);
     }
     return;
 }
@@ -1199,9 +1441,11 @@ void mos6502::Op_CPY(uint16_t src)
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_DEC(uint16_t src)
 {
     uint8_t m = Read(src);
+    if constexpr (cycleStepped) Write(src, m);
     m = (m - 1) % 256;
     SET_NEGATIVE(m & 0x80);
     SET_ZERO(!m);
@@ -1238,9 +1482,11 @@ void mos6502::Op_EOR(uint16_t src)
     A = m;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_INC(uint16_t src)
 {
     uint8_t m = Read(src);
+    if constexpr (cycleStepped) Write(src, m);
     m = (m + 1) % 256;
     SET_NEGATIVE(m & 0x80);
     SET_ZERO(!m);
@@ -1270,8 +1516,22 @@ void mos6502::Op_JMP(uint16_t src)
     pc = src;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_JSR(uint16_t src)
 {
+    if constexpr (cycleStepped)
+    {
+        // src is where the low byte of the target is, and pc is on the high byte, which is the
+        // return address that gets pushed. The stack pointer is read while the processor waits on
+        // the stack, and the high byte is read last, as on the NMOS part
+        uint16_t addrL = Read(src);
+        Read(0x0100 + sp);
+        StackPush((pc >> 8) & 0xFF);
+        StackPush(pc & 0xFF);
+        uint16_t addrH = Read(pc);
+        pc = addrL + (addrH << 8);
+        return;
+    }
     pc--;
     StackPush((pc >> 8) & 0xFF);
     StackPush(pc & 0xFF);
@@ -1302,9 +1562,11 @@ void mos6502::Op_LDY(uint16_t src)
     Y = m;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_LSR(uint16_t src)
 {
     uint8_t m = Read(src);
+    if constexpr (cycleStepped) Write(src, m);
     SET_CARRY(m & 0x01);
     m >>= 1;
     SET_NEGATIVE(0);
@@ -1348,24 +1610,31 @@ void mos6502::Op_PHP(uint16_t src)
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_PLA(uint16_t src)
 {
+    // pulls spend a cycle reading the stack before the pointer is incremented
+    if constexpr (cycleStepped) Read(0x0100 + sp);
     A = StackPop();
     SET_NEGATIVE(A & 0x80);
     SET_ZERO(!A);
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_PLP(uint16_t src)
 {
+    if constexpr (cycleStepped) Read(0x0100 + sp);
     status = StackPop() | CONSTANT | BREAK;
     //SET_CONSTANT(1);
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_ROL(uint16_t src)
 {
     uint16_t m = Read(src);
+    if constexpr (cycleStepped) Write(src, m);
     m <<= 1;
     if (IF_CARRY()) m |= 0x01;
     SET_CARRY(m > 0xFF);
@@ -1389,9 +1658,11 @@ void mos6502::Op_ROL_ACC(uint16_t src)
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_ROR(uint16_t src)
 {
     uint16_t m = Read(src);
+    if constexpr (cycleStepped) Write(src, m);
     if (IF_CARRY()) m |= 0x100;
     SET_CARRY(m & 0x01);
     m >>= 1;
@@ -1415,10 +1686,12 @@ void mos6502::Op_ROR_ACC(uint16_t src)
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_RTI(uint16_t src)
 {
     uint8_t lo, hi;
 
+    if constexpr (cycleStepped) Read(0x0100 + sp);
     status = StackPop() | CONSTANT | BREAK;
 
     lo = StackPop();
@@ -1428,12 +1701,16 @@ void mos6502::Op_RTI(uint16_t src)
     return;
 }
 
+template<bool cycleStepped>
 void mos6502::Op_RTS(uint16_t src)
 {
     uint8_t lo, hi;
 
+    if constexpr (cycleStepped) Read(0x0100 + sp);
     lo = StackPop();
     hi = StackPop();
+    // the return address is read again while it's incremented
+    if constexpr (cycleStepped) Read((hi << 8) | lo);
 
     pc = ((hi << 8) | lo) + 1;
     return;
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <iostream>
+#include <atomic>
 #include <stdint.h>
 using namespace std;
 
@@ -77,41 +78,80 @@ private:
 
     Instr InstrTable[256];
 
+    // the same instructions with every dummy bus access the hardware makes,
+    // used by RunCycleStepped()
+    Instr CycleSteppedInstrTable[256];
+
+    template<bool cycleStepped> void FillInstrTable(Instr *table);
+
     void Exec(Instr i);
 
-    bool illegalOpcode;
+    // halt state
+    bool halted;
+    uint8_t haltReason;
+    uint16_t haltPC;
+    // address of the instruction being run, for Trap()
+    uint16_t opcodePC;
+    bool haltOnBRK;
+    void Halt(uint8_t reason);
+
+    // run statistics
+    uint64_t instructionCount;
+    uint64_t interruptCount;
+
+    // interrupt lines, sampled once per instruction. points to noInterrupts
+    // unless an interrupt controller is connected
+    std::atomic<uint32_t> *interruptPending;
+    std::atomic<uint32_t> noInterrupts;
+
+    // take the pending interrupt if there's one that can be taken,
+    // returns the cycles it took
+    template<bool cycleStepped> uint8_t ServiceInterrupts(uint32_t pending);
+
+    // cycles taken by the current instruction on top of instr.cycles
+    // (page crossings and taken branches), cleared before each instruction
+    uint8_t extraCycles;
+
+    // take a branch, charging 1 cycle plus 1 more if it crosses a page
+    template<bool cycleStepped> void Branch(uint16_t target);
+
+    // the read an indexed mode makes before fixing up the high byte
+    template<bool pageCrossPenalty> void IndexedDummyRead(uint16_t addrH, uint16_t indexedL);
 
     // addressing modes
-    uint16_t Addr_ACC(); // ACCUMULATOR
+    // (the cycleStepped versions also make the dummy bus accesses the hardware does)
+    template<bool cycleStepped> uint16_t Addr_ACC(); // ACCUMULATOR
     uint16_t Addr_IMM(); // IMMEDIATE
     uint16_t Addr_ABS(); // ABSOLUTE
     uint16_t Addr_ZER(); // ZERO PAGE
-    uint16_t Addr_ZEX(); // INDEXED-X ZERO PAGE
-    uint16_t Addr_ZEY(); // INDEXED-Y ZERO PAGE
-    uint16_t Addr_ABX(); // INDEXED-X ABSOLUTE
-    uint16_t Addr_ABY(); // INDEXED-Y ABSOLUTE
-    uint16_t Addr_IMP(); // IMPLIED
+    template<bool cycleStepped> uint16_t Addr_ZEX(); // INDEXED-X ZERO PAGE
+    template<bool cycleStepped> uint16_t Addr_ZEY(); // INDEXED-Y ZERO PAGE
+    // the indexed modes charge a cycle for crossing a page if pageCrossPenalty
+    // is set (reads), stores and read-modify-writes always take the long path
+    template<bool pageCrossPenalty, bool cycleStepped> uint16_t Addr_ABX(); // INDEXED-X ABSOLUTE
+    template<bool pageCrossPenalty, bool cycleStepped> uint16_t Addr_ABY(); // INDEXED-Y ABSOLUTE
+    template<bool cycleStepped> uint16_t Addr_IMP(); // IMPLIED
     uint16_t Addr_REL(); // RELATIVE
-    uint16_t Addr_INX(); // INDEXED-X INDIRECT
-    uint16_t Addr_INY(); // INDEXED-Y INDIRECT
+    template<bool cycleStepped> uint16_t Addr_INX(); // INDEXED-X INDIRECT
+    template<bool pageCrossPenalty, bool cycleStepped> uint16_t Addr_INY(); // INDEXED-Y INDIRECT
     uint16_t Addr_ABI(); // ABSOLUTE INDIRECT
 
     // opcodes (grouped as per datasheet)
     void Op_ADC(uint16_t src);
     void Op_AND(uint16_t src);
-    void Op_ASL(uint16_t src); 	void Op_ASL_ACC(uint16_t src);
-    void Op_BCC(uint16_t src);
-    void Op_BCS(uint16_t src);
+    template<bool cycleStepped> void Op_ASL(uint16_t src); 	void Op_ASL_ACC(uint16_t src);
+    template<bool cycleStepped> void Op_BCC(uint16_t src);
+    template<bool cycleStepped> void Op_BCS(uint16_t src);
 
-    void Op_BEQ(uint16_t src);
+    template<bool cycleStepped> void Op_BEQ(uint16_t src);
     void Op_BIT(uint16_t src);
-    void Op_BMI(uint16_t src);
-    void Op_BNE(uint16_t src);
-    void Op_BPL(uint16_t src);
+    template<bool cycleStepped> void Op_BMI(uint16_t src);
+    template<bool cycleStepped> void Op_BNE(uint16_t src);
+    template<bool cycleStepped> void Op_BPL(uint16_t src);
 
     void Op_BRK(uint16_t src);
-    void Op_BVC(uint16_t src);
-    void Op_BVS(uint16_t src);
+    template<bool cycleStepped> void Op_BVC(uint16_t src);
+    template<bool cycleStepped> void Op_BVS(uint16_t src);
     void Op_CLC(uint16_t src);
     void Op_CLD(uint16_t src);
 
@@ -121,33 +161,33 @@ private:
     void Op_CPX(uint16_t src);
     void Op_CPY(uint16_t src);
 
-    void Op_DEC(uint16_t src);
+    template<bool cycleStepped> void Op_DEC(uint16_t src);
     void Op_DEX(uint16_t src);
     void Op_DEY(uint16_t src);
     void Op_EOR(uint16_t src);
-    void Op_INC(uint16_t src);
+    template<bool cycleStepped> void Op_INC(uint16_t src);
 
     void Op_INX(uint16_t src);
     void Op_INY(uint16_t src);
     void Op_JMP(uint16_t src);
-    void Op_JSR(uint16_t src);
+    template<bool cycleStepped> void Op_JSR(uint16_t src);
     void Op_LDA(uint16_t src);
 
     void Op_LDX(uint16_t src);
     void Op_LDY(uint16_t src);
-    void Op_LSR(uint16_t src); 	void Op_LSR_ACC(uint16_t src);
+    template<bool cycleStepped> void Op_LSR(uint16_t src); 	void Op_LSR_ACC(uint16_t src);
     void Op_NOP(uint16_t src);
     void Op_ORA(uint16_t src);
 
     void Op_PHA(uint16_t src);
     void Op_PHP(uint16_t src);
-    void Op_PLA(uint16_t src);
-    void Op_PLP(uint16_t src);
-    void Op_ROL(uint16_t src); 	void Op_ROL_ACC(uint16_t src);
+    template<bool cycleStepped> void Op_PLA(uint16_t src);
+    template<bool cycleStepped> void Op_PLP(uint16_t src);
+    template<bool cycleStepped> void Op_ROL(uint16_t src); 	void Op_ROL_ACC(uint16_t src);
 
-    void Op_ROR(uint16_t src);	void Op_ROR_ACC(uint16_t src);
-    void Op_RTI(uint16_t src);
-    void Op_RTS(uint16_t src);
+    template<bool cycleStepped> void Op_ROR(uint16_t src);	void Op_ROR_ACC(uint16_t src);
+    template<bool cycleStepped> void Op_RTI(uint16_t src);
+    template<bool cycleStepped> void Op_RTS(uint16_t src);
     void Op_SBC(uint16_t src);
     void Op_SEC(uint16_t src);
     void Op_SED(uint16_t src);
@@ -165,6 +205,7 @@ private:
     void Op_TYA(uint16_t src);
 
     void Op_ILLEGAL(uint16_t src);
+    void Op_STP(uint16_t src);
 
     // IRQ, reset, NMI vectors
     static const uint16_t irqVectorH = 0xFFFF;
@@ -179,6 +220,8 @@ private:
     typedef uint8_t (*BusRead)(uint16_t);
     BusRead Read;
     BusWrite Write;
+    // opcode fetches, so the bus can tell them apart from other reads
+    BusRead Fetch;
 
     // stack operations
     inline void StackPush(uint8_t byte);
@@ -189,20 +232,52 @@ public:
         INST_COUNT,
         CYCLE_COUNT,
     };
-    mos6502(BusRead r, BusWrite w);
+    enum HaltReason {
+        NOT_HALTED,
+        ILLEGAL_OPCODE,
+        BREAK_TRAP,
+        STOP_INSTRUCTION,
+        PROTECTION_FAULT,
+    };
+    // bit of the pending interrupt word set by an NMI edge, the processor
+    // clears it when it takes the NMI. any other bit is an asserted IRQ line
+    static constexpr uint32_t NMI_PENDING = 0x80000000;
+    // f is used for opcode fetches, r if it's left out
+    mos6502(BusRead r, BusWrite w, BusRead f = nullptr);
     void NMI();
     void IRQ();
+    // sample interrupts from the given word at every instruction boundary,
+    // nullptr to disconnect. can be set from another thread
+    void SetInterruptPending(std::atomic<uint32_t> *pending);
     void Reset();
     void Run(
         int32_t cycles,
         uint64_t& cycleCount,
         CycleMethod cycleMethod = CYCLE_COUNT);
+    // like Run(), but every cycle is a bus access made in the order the
+    // hardware makes them, dummy reads and the double write of
+    // read-modify-write instructions included. a bus that counts its
+    // accesses knows which cycle each of them happens on
+    void RunCycleStepped(
+        int32_t cycles,
+        uint64_t& cycleCount,
+        CycleMethod cycleMethod = CYCLE_COUNT);
     uint16_t GetPC();
     uint8_t GetS();
     uint8_t GetP();
     uint8_t GetA();
     uint8_t GetX();
     uint8_t GetY();
+    uint64_t GetInstructionCount();
+    uint64_t GetInterruptCount();
+    bool IsHalted();
+    HaltReason GetHaltReason();
+    uint16_t GetHaltPC();
+    // halt once the current instruction is done, with the halt pc on it.
+    // for the bus, when an access part way through an instruction faults
+    void Trap(HaltReason reason);
+    void SetHaltOnBRK(bool value);
+    bool GetHaltOnBRK();
     void SetResetS(uint8_t value);
     void SetResetP(uint8_t value);
     void SetResetA(uint8_t value);
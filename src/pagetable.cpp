@@ -0,0 +1,58 @@
+#include "pagetable.h"
+
+#include <algorithm>
+
+namespace{
+    /**
+     * The pages fully inside a range, as [first, end)
+     */
+    void wholePages(uint16_t address, size_t length, size_t &first, size_t &end){
+        size_t range_end = std::min<size_t>(0x10000, (size_t) address + length);
+        first = ((size_t) address + PageTable::kPageSize - 1) >> PageTable::kPageBits;
+        end = std::max(first, range_end >> PageTable::kPageBits);
+    }
+}
+
+void PageTable::mapMemory(uint16_t address, size_t length, uint8_t *read_memory, uint8_t *write_memory){
+    size_t first, end;
+    wholePages(address, length, first, end);
+    for(size_t page = first; page < end; page++){
+        size_t offset = (page << kPageBits) - address;
+        mappings[page].read_memory = read_memory == nullptr ? nullptr : read_memory + offset;
+        mappings[page].write_memory = write_memory == nullptr ? nullptr : write_memory + offset;
+        applyMapping(page);
+    }
+}
+
+void PageTable::unmapMemory(uint16_t address, size_t length){
+    mapMemory(address, length, nullptr, nullptr);
+}
+
+void PageTable::setDevice(uint16_t address, size_t length, MemoryMappedDevice *device){
+    if(length == 0) return;
+    size_t first, end;
+    wholePages(address, length, first, end);
+    for(size_t page = first; page < end; page++) entries[page].device = device;
+
+    // Whatever else is on the pages at the edges has to be looked up
+    size_t first_page = address >> kPageBits;
+    size_t last_page = (std::min<size_t>(0x10000, (size_t) address + length) - 1) >> kPageBits;
+    if(first_page < first || first_page >= end) entries[first_page].device = nullptr;
+    if(last_page < first || last_page >= end) entries[last_page].device = nullptr;
+}
+
+void PageTable::setPermissions(uint16_t address, size_t length, uint8_t permissions){
+    size_t first, end;
+    wholePages(address, length, first, end);
+    for(size_t page = first; page < end; page++){
+        entries[page].permissions = permissions;
+        applyMapping(page);
+    }
+}
+
+void PageTable::applyMapping(size_t page){
+    Entry &entry = entries[page];
+    entry.read_memory = (entry.permissions & READ) ? mappings[page].read_memory : nullptr;
+    entry.write_memory = (entry.permissions & WRITE) ? mappings[page].write_memory : nullptr;
+    entry.fetch_memory = (entry.permissions & EXECUTE) ? mappings[page].read_memory : nullptr;
+}
@@ -0,0 +1,134 @@
+#ifndef PAGETABLE_H
+#define PAGETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+class MemoryMappedDevice;
+
+/**
+ * How the bus finds what's behind an address, one entry per 256 byte page
+ *
+ * A page of plain memory points straight at its storage and the processor reads and writes it
+ * without going through a device at all. Any other page names the device it belongs to, if the
+ * whole page is one device's. Devices map their storage in themselves (see
+ * MemoryMappedDevice::attachPageTable()), so switching a bank is a couple of pointer stores per page
+ *
+ * Pages also have permissions. A page the processor can't read, write or execute has no storage for
+ * that kind of access, so the bus only looks at the permissions once it's already off the fast path,
+ * and protection costs nothing until something breaks it
+ */
+class PageTable{
+public:
+    /**
+     * Pages are 2^kPageBits bytes
+     */
+    constexpr static int kPageBits = 8;
+    constexpr static size_t kPageSize = 1 << kPageBits;
+    constexpr static size_t kPageCount = 0x10000 >> kPageBits;
+    constexpr static uint16_t kOffsetMask = kPageSize - 1;
+
+    /**
+     * What the processor may do with a page, pages allow everything unless they're restricted
+     */
+    enum Permission{
+        READ = 0x1,
+        WRITE = 0x2,
+        EXECUTE = 0x4, // Operands are read like data, so executable pages have to be readable too
+        ALL = READ | WRITE | EXECUTE
+    };
+
+    struct Entry{
+        /**
+         * The page's storage for reads, nullptr to go through the device
+         */
+        uint8_t *read_memory = nullptr;
+
+        /**
+         * The page's storage for writes, nullptr to go through the device
+         */
+        uint8_t *write_memory = nullptr;
+
+        /**
+         * The page's storage for opcode fetches, nullptr to go through the device
+         */
+        uint8_t *fetch_memory = nullptr;
+
+        /**
+         * The device the whole page belongs to, nullptr if it's shared between devices or unmapped
+         */
+        MemoryMappedDevice *device = nullptr;
+
+        /**
+         * Permission bits
+         */
+        uint8_t permissions = ALL;
+    };
+
+    /**
+     * Get the entry of the page an address is in
+     *
+     * @param address
+     */
+    Entry &entryFor(uint16_t address){
+        return entries[address >> kPageBits];
+    }
+
+    /**
+     * Point the pages fully inside a range of addresses straight at their storage. Pages only partly
+     * inside are left alone, they keep going through the device
+     *
+     * @param address The first address of the range
+     * @param length
+     * @param read_memory The storage of the first address for reads
+     * @param write_memory The storage of the first address for writes, nullptr to send writes through the device
+     */
+    void mapMemory(uint16_t address, size_t length, uint8_t *read_memory, uint8_t *write_memory);
+
+    /**
+     * Send the pages fully inside a range back through their device
+     *
+     * @param address
+     * @param length
+     */
+    void unmapMemory(uint16_t address, size_t length);
+
+    /**
+     * Give the pages fully inside a range to a device, and mark the ones it only partly covers as shared
+     *
+     * @param address
+     * @param length
+     * @param device
+     */
+    void setDevice(uint16_t address, size_t length, MemoryMappedDevice *device);
+
+    /**
+     * Restrict what the processor may do with the pages fully inside a range of addresses
+     *
+     * @param address
+     * @param length
+     * @param permissions Permission bits
+     */
+    void setPermissions(uint16_t address, size_t length, uint8_t permissions);
+
+private:
+    /**
+     * The storage mapped at a page, whether or not its permissions let the processor at it
+     */
+    struct Mapping{
+        uint8_t *read_memory = nullptr;
+        uint8_t *write_memory = nullptr;
+    };
+
+    /**
+     * Point a page's entry at its mapping, as far as its permissions allow
+     *
+     * @param page
+     */
+    void applyMapping(size_t page);
+
+    Entry entries[kPageCount];
+    Mapping mappings[kPageCount];
+};
+
+#endif // PAGETABLE_H
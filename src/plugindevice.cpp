@@ -0,0 +1,142 @@
+#include "plugindevice.h"
+
+#include <QLibrary>
+
+#include "pagetable.h"
+
+PluginDevice *PluginDevice::load(const std::string &library_path, uint16_t base_address, size_t length, const std::string &options,
+                                 EventScheduler *scheduler, InterruptController *interrupt_controller, const std::atomic<int> &clock_speed, QString &error){
+    QLibrary *library = new QLibrary(QString::fromStdString(library_path));
+    if(!library -> load()){
+        error = library -> errorString();
+        delete library;
+        return nullptr;
+    }
+    EmulatorPluginCreateFunction create = (EmulatorPluginCreateFunction) library -> resolve(EMULATOR_PLUGIN_CREATE_SYMBOL);
+    if(create == nullptr){
+        error = QString::fromStdString(library_path) + " doesn't export " + EMULATOR_PLUGIN_CREATE_SYMBOL;
+        library -> unload();
+        delete library;
+        return nullptr;
+    }
+
+    // The device owns the library from here on, so it's unloaded when the device is deleted
+    PluginDevice *device = new PluginDevice(base_address, length, library, scheduler, interrupt_controller, clock_speed);
+    if(create(EMULATOR_PLUGIN_ABI_VERSION, &device -> host, base_address, length, options.c_str(), &device -> plugin) != 0){
+        error = QString::fromStdString(library_path) + " couldn't create the device";
+        device -> plugin = {};
+        delete device;
+        return nullptr;
+    }
+    if(device -> plugin.memory == nullptr && (device -> plugin.read == nullptr || device -> plugin.write == nullptr)){
+        error = QString::fromStdString(library_path) + " gave neither memory nor read and write callbacks";
+        delete device;
+        return nullptr;
+    }
+    device -> needs_sync = device -> plugin.sync != nullptr;
+    return device;
+}
+
+PluginDevice::PluginDevice(uint16_t base_address, size_t length, QLibrary *library, EventScheduler *scheduler,
+                           InterruptController *interrupt_controller, const std::atomic<int> &clock_speed) : MemoryMappedDevice(base_address, length),
+                                                                                                           library{library},
+                                                                                                           scheduler{scheduler},
+                                                                                                           interrupt_controller{interrupt_controller},
+                                                                                                           clock_speed{clock_speed}{
+    irq_line = interrupt_controller -> allocateLine();
+    host.host = this;
+    host.get_clock_speed = hostGetClockSpeed;
+    host.schedule_event = hostScheduleEvent;
+    host.cancel_event = hostCancelEvent;
+    host.set_irq = hostSetIRQ;
+    host.set_nmi = hostSetNMI;
+}
+
+PluginDevice::~PluginDevice(){
+    if(plugin.destroy != nullptr) plugin.destroy(plugin.device);
+    // Don't leave callbacks into the library behind
+    for(auto const &event : pending_events) scheduler -> cancel(event.second);
+    interrupt_controller -> lowerIRQ(irq_line);
+    interrupt_controller -> setNMI(irq_line, false);
+    library -> unload();
+    delete library;
+}
+
+bool PluginDevice::setValue(uint16_t address, uint8_t value){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return false;
+
+    if(plugin.memory != nullptr && !plugin.memory_read_only){
+        plugin.memory[relative_address] = value;
+    }else if(plugin.write != nullptr){
+        plugin.write(plugin.device, relative_address, value);
+    }
+    return true;
+}
+
+uint8_t PluginDevice::getValue(uint16_t address){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+
+    if(plugin.memory != nullptr) return plugin.memory[relative_address];
+    return plugin.read(plugin.device, relative_address);
+}
+
+uint8_t PluginDevice::peekValue(uint16_t address){
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+
+    if(plugin.memory != nullptr) return plugin.memory[relative_address];
+    if(plugin.peek != nullptr) return plugin.peek(plugin.device, relative_address);
+    return plugin.read(plugin.device, relative_address);
+}
+
+uint8_t *PluginDevice::getDirectMemory(uint16_t address, size_t &length){
+    size_t relative_address = address - this -> base_address;
+    if(plugin.memory == nullptr || relative_address >= this -> address_space_length) return nullptr;
+    length = this -> address_space_length - relative_address;
+    return plugin.memory + relative_address;
+}
+
+void PluginDevice::attachPageTable(PageTable *page_table){
+    if(plugin.memory == nullptr) return;
+    page_table -> mapMemory(base_address, address_space_length, plugin.memory, plugin.memory_read_only ? nullptr : plugin.memory);
+}
+
+void PluginDevice::sync(uint64_t cycle){
+    plugin.sync(plugin.device, cycle);
+}
+
+uint32_t PluginDevice::hostGetClockSpeed(void *host){
+    return ((PluginDevice*) host) -> clock_speed;
+}
+
+EmulatorEventId PluginDevice::hostScheduleEvent(void *host, uint64_t cycle, EmulatorEventCallback callback, void *device){
+    PluginDevice *plugin_device = (PluginDevice*) host;
+    EmulatorEventId id = plugin_device -> next_event_id++;
+    plugin_device -> pending_events[id] = plugin_device -> scheduler -> schedule(cycle, [plugin_device, id, callback, device](uint64_t fired_cycle){
+        plugin_device -> pending_events.erase(id);
+        callback(device, fired_cycle);
+    });
+    return id;
+}
+
+void PluginDevice::hostCancelEvent(void *host, EmulatorEventId id){
+    PluginDevice *plugin_device = (PluginDevice*) host;
+    auto event = plugin_device -> pending_events.find(id);
+    if(event == plugin_device -> pending_events.end()) return;
+    plugin_device -> scheduler -> cancel(event -> second);
+    plugin_device -> pending_events.erase(event);
+}
+
+void PluginDevice::hostSetIRQ(void *host, int asserted){
+    PluginDevice *plugin_device = (PluginDevice*) host;
+    plugin_device -> interrupt_controller -> setIRQ(plugin_device -> irq_line, asserted != 0);
+}
+
+void PluginDevice::hostSetNMI(void *host, int asserted){
+    PluginDevice *plugin_device = (PluginDevice*) host;
+    plugin_device -> interrupt_controller -> setNMI(plugin_device -> irq_line, asserted != 0);
+}
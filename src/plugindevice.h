@@ -0,0 +1,93 @@
+#ifndef PLUGINDEVICE_H
+#define PLUGINDEVICE_H
+
+#include <QString>
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+#include "deviceplugin.h"
+#include "eventscheduler.h"
+#include "interruptcontroller.h"
+#include "memorymappeddevice.h"
+
+class QLibrary;
+
+/**
+ * A device from a plugin library, see deviceplugin.h for the interface plugins implement
+ *
+ * Plugins that are plain memory are mapped into the page table like RAM, so the processor accesses
+ * them without calling into the plugin at all. Everything else calls the plugin's callbacks
+ * straight from getValue() and setValue(), the same virtual call a built-in device costs plus an
+ * indirect one
+ */
+class PluginDevice : public MemoryMappedDevice{
+public:
+    /**
+     * Load a plugin library and create a device with it
+     *
+     * @param library_path The library, the platform's suffix can be left out
+     * @param base_address
+     * @param length How many addresses the device has
+     * @param options Passed to the plugin as is
+     * @param scheduler Where the plugin's events are scheduled
+     * @param interrupt_controller Where the plugin's interrupts go, the device takes a line of its own
+     * @param clock_speed The processor clock, for the plugin to time things with
+     * @param error Set to what went wrong, if anything
+     * @return The device, nullptr if the library can't be loaded or the plugin refuses
+     */
+    static PluginDevice *load(const std::string &library_path, uint16_t base_address, size_t length, const std::string &options,
+                              EventScheduler *scheduler, InterruptController *interrupt_controller, const std::atomic<int> &clock_speed, QString &error);
+    ~PluginDevice();
+
+    bool setValue(uint16_t address, uint8_t value) override;
+    uint8_t getValue(uint16_t address) override;
+    uint8_t peekValue(uint16_t address) override;
+    uint8_t *getDirectMemory(uint16_t address, size_t &length) override;
+    void attachPageTable(PageTable *page_table) override;
+    void sync(uint64_t cycle) override;
+
+private:
+    PluginDevice(uint16_t base_address, size_t length, QLibrary *library, EventScheduler *scheduler,
+                 InterruptController *interrupt_controller, const std::atomic<int> &clock_speed);
+
+    /**
+     * The host functions handed to the plugin, host is the device
+     */
+    static uint32_t hostGetClockSpeed(void *host);
+    static EmulatorEventId hostScheduleEvent(void *host, uint64_t cycle, EmulatorEventCallback callback, void *device);
+    static void hostCancelEvent(void *host, EmulatorEventId id);
+    static void hostSetIRQ(void *host, int asserted);
+    static void hostSetNMI(void *host, int asserted);
+
+    /**
+     * The library the plugin came from, unloaded once the device is destroyed
+     */
+    QLibrary *library;
+
+    EventScheduler *scheduler;
+    InterruptController *interrupt_controller;
+    const std::atomic<int> &clock_speed;
+
+    /**
+     * Our line on the interrupt controller
+     */
+    unsigned irq_line;
+
+    EmulatorPluginHost host;
+
+    /**
+     * Filled in by the plugin
+     */
+    EmulatorPluginDevice plugin = {};
+
+    /**
+     * The plugin's events that haven't fired yet, by the id the plugin knows them by, so none are
+     * left behind when the device goes away
+     */
+    std::unordered_map<EmulatorEventId, EventScheduler::EventId> pending_events;
+    EmulatorEventId next_event_id = 0;
+};
+
+#endif // PLUGINDEVICE_H
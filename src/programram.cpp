@@ -1,16 +1,11 @@
 #include "programram.h"
 
-#include <cstring>
+#include "memoryarena.h"
+#include "pagetable.h"
 
-ProgramRAM::ProgramRAM(uint16_t base_address, size_t length) : MemoryMappedDevice(base_address, length){
-    // Instantiate the memory array with the given size
-    this -> memory = new uint8_t[length];
-    memset(this -> memory, 0xff, length);
-}
-
-ProgramRAM::~ProgramRAM(){
-    // Clean up the memory array
-    delete[] memory;
+ProgramRAM::ProgramRAM(uint16_t base_address, size_t length, MemoryArena *arena) : MemoryMappedDevice(base_address, length){
+    // The arena hands it out blank
+    this -> memory = arena -> allocate(length);
 }
 
 bool ProgramRAM::setValue(uint16_t address, uint8_t value){
@@ -34,3 +29,14 @@ uint8_t ProgramRAM::getValue(uint16_t address){
     // Return -1 for invalid address
     return 0xFF;
 }
+
+uint8_t *ProgramRAM::getDirectMemory(uint16_t address, size_t &length){
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return nullptr;
+    length = this -> address_space_length - relative_address;
+    return memory + relative_address;
+}
+
+void ProgramRAM::attachPageTable(PageTable *page_table){
+    page_table -> mapMemory(base_address, address_space_length, memory, memory);
+}
@@ -3,18 +3,25 @@
 
 #include "memorymappeddevice.h"
 
+class MemoryArena;
 
 class ProgramRAM : public MemoryMappedDevice {
 public:
-    ProgramRAM(uint16_t base_address, size_t length);
-    ~ProgramRAM();
+    /**
+     * @param base_address
+     * @param length
+     * @param arena Where the memory comes from
+     */
+    ProgramRAM(uint16_t base_address, size_t length, MemoryArena *arena);
 
     bool setValue(uint16_t address, uint8_t value) override;
     uint8_t getValue(uint16_t address) override;
+    uint8_t *getDirectMemory(uint16_t address, size_t &length) override;
+    void attachPageTable(PageTable *page_table) override;
 
 private:
     /**
-     * Buffer for the memory data
+     * Buffer for the memory data, owned by the arena
      */
     uint8_t *memory;
 };
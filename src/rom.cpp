@@ -1,44 +1,32 @@
 #include "rom.h"
 
-#include <cstring>
-
-ROM::ROM(uint16_t base_address, size_t length, size_t kNumBankedMemories) : MemoryMappedDevice(base_address, length),
-                                                                                kNumBankedMemories{kNumBankedMemories},
-                                                                                memorySize{length}{
-    // Create and initialise the memory arrays
-    memories = new uint8_t*[kNumBankedMemories];
-    for(int bankNum = 0; bankNum < kNumBankedMemories; bankNum++){
-        memories[bankNum] = new uint8_t[memorySize];
-        memset(memories[bankNum], 0xFF, memorySize);
-    }
-
-    // Make the garbage data here at least valid
-    current_bank_number = current_bank_number % kNumBankedMemories;
+#include "memoryarena.h"
+#include "pagetable.h"
 
-}
+ROM::ROM(uint16_t base_address, size_t length, size_t kNumBankedMemories, MemoryArena *arena) : MemoryMappedDevice(base_address, length),
+                                                                                                    kNumBankedMemories{kNumBankedMemories},
+                                                                                                    memorySize{length}{
+    // The banks are one block, one after the other, and the arena hands it out blank
+    banks = arena -> allocate(memorySize * kNumBankedMemories);
 
-ROM::~ROM(){
-    // Delete both levels of the memrory array
-    for(int bankNum = 0; bankNum < kNumBankedMemories; bankNum++){
-        delete[] memories[bankNum];
-    }
-    delete[] memories;
+    // Start out on the first bank
+    current_bank_number = 0;
 }
 
 bool ROM::setValue(uint16_t address, uint8_t value){
     if(address == base_address){
         // Relative address 0 is the bank number register
         current_bank_number = value;
+        mapBank();
         // Notify that we changed a bunch of addresses
-        // TODO: This should ideally be a single call passed all the way up
-        for(int i = base_address; i < base_address + address_space_length; i++)
-            emit addressChanged(i);
+        emit addressRangeChanged(base_address + 1, base_address + memorySize);
         return true;
     }else{
         // Everything else is a VRAM address
         uint16_t relative_address = address - (base_address + 1);
-        if(relative_address < memorySize){
-            memories[current_bank_number][relative_address] = value;
+        uint8_t *bank = getCurrentBank();
+        if(relative_address < memorySize && bank != nullptr){
+            bank[relative_address] = value;
             return true;
         }
         return false;
@@ -52,9 +40,46 @@ uint8_t ROM::getValue(uint16_t address){
     } else {
         // Grab value from memory, check if it's valid and if so, return it
         uint16_t relative_address = address - (base_address + 1);
-        if(relative_address < memorySize){
-            return memories[current_bank_number][relative_address];
+        uint8_t *bank = getCurrentBank();
+        if(relative_address < memorySize && bank != nullptr){
+            return bank[relative_address];
         }
-        return 0xFF; // Return -1 if the address is invalid
+        return 0xFF; // Return -1 if the address is invalid, or there's no such bank
+    }
+}
+
+uint8_t *ROM::getDirectMemory(uint16_t address, size_t &length){
+    // The bank number register isn't memory, and the pointer is only good until the bank changes
+    if(address == base_address) return nullptr;
+    uint16_t relative_address = address - (base_address + 1);
+    uint8_t *bank = getCurrentBank();
+    if(relative_address >= memorySize || bank == nullptr) return nullptr;
+    length = memorySize - relative_address;
+    return bank + relative_address;
+}
+
+uint8_t *ROM::getBank(size_t bank){
+    return banks + bank * memorySize;
+}
+
+uint8_t *ROM::getCurrentBank(){
+    // The bank number register takes any value, not all of them are banks
+    if(current_bank_number >= kNumBankedMemories) return nullptr;
+    return getBank(current_bank_number);
+}
+
+void ROM::attachPageTable(PageTable *page_table){
+    this -> page_table = page_table;
+    mapBank();
+}
+
+void ROM::mapBank(){
+    if(page_table == nullptr) return;
+    // A bank switch is a pointer store per page, the processor reads the bank straight from there
+    uint8_t *bank = getCurrentBank();
+    if(bank != nullptr){
+        page_table -> mapMemory(base_address + 1, memorySize, bank, bank);
+    }else{
+        page_table -> unmapMemory(base_address + 1, memorySize);
     }
 }
@@ -1,22 +1,54 @@
-#ifndef VRAM_H
-#define VRAM_H
+#ifndef ROM_H
+#define ROM_H
 
 #include "memorymappeddevice.h"
 
+class MemoryArena;
+
 class ROM : public MemoryMappedDevice
 {
 public:
-    ROM(uint16_t base_address, size_t length, size_t kNumBankedMemories);
-    ~ROM();
+    /**
+     * @param base_address Where the bank number register is, the memory follows it
+     * @param length
+     * @param kNumBankedMemories
+     * @param arena Where the banks come from
+     */
+    ROM(uint16_t base_address, size_t length, size_t kNumBankedMemories, MemoryArena *arena);
 
     bool setValue(uint16_t address, uint8_t value) override;
     uint8_t getValue(uint16_t address) override;
+    uint8_t *getDirectMemory(uint16_t address, size_t &length) override;
+    void attachPageTable(PageTable *page_table) override;
+
+    /**
+     * Get the storage of a bank, for loading its contents
+     *
+     * @param bank
+     * @return The bank, memorySize bytes long
+     */
+    uint8_t *getBank(size_t bank);
 
 private:
     /**
-     * 2D array (not really) of all the banked memories
+     * Point our pages at the current bank
+     */
+    void mapBank();
+
+    /**
+     * @return The selected bank, nullptr if the bank number register doesn't select one
+     */
+    uint8_t *getCurrentBank();
+
+    /**
+     * Where the current bank is mapped, nullptr until we're on the bus
+     */
+    PageTable *page_table = nullptr;
+
+    /**
+     * All the banked memories, one after the other. Owned by the arena
      */
-    uint8_t** memories;
+    uint8_t *banks;
     /**
      * Currently selected bank of memory
      */
@@ -34,4 +66,4 @@ private:
     const size_t memorySize;
 };
 
-#endif // VRAM_H
+#endif // ROM_H
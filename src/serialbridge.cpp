@@ -0,0 +1,140 @@
+#include "serialbridge.h"
+
+#include <QtGlobal>
+
+#include <cerrno>
+#include <chrono>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#include "log.h"
+
+SerialBridge::SerialBridge(ACIA *serial_port, int input_fd, int output_fd, bool owns_fds) : serial_port{serial_port},
+                                                                                            input_fd{input_fd},
+                                                                                            output_fd{output_fd},
+                                                                                            owns_fds{owns_fds} {}
+
+SerialBridge::~SerialBridge(){
+    stop();
+    serial_port -> detachHost();
+#ifdef Q_OS_UNIX
+    if(owns_fds){
+        close(input_fd);
+        if(output_fd != input_fd) close(output_fd);
+    }
+#endif
+}
+
+SerialBridge *SerialBridge::openStdio(ACIA *serial_port){
+#ifdef Q_OS_UNIX
+    if(!serial_port -> attachHost()){
+        Log::Warning() << "The serial port is already connected";
+        return nullptr;
+    }
+    return new SerialBridge(serial_port, STDIN_FILENO, STDOUT_FILENO);
+#else
+    Log::Warning() << "Connecting the serial port to stdio isn't supported on this platform";
+    return nullptr;
+#endif
+}
+
+SerialBridge *SerialBridge::openPseudoTerminal(ACIA *serial_port, std::string &terminal_name){
+#ifdef Q_OS_UNIX
+    int master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master_fd < 0 || grantpt(master_fd) != 0 || unlockpt(master_fd) != 0){
+        Log::Warning() << "Could not open a pseudo-terminal for the serial port";
+        if(master_fd >= 0) close(master_fd);
+        return nullptr;
+    }
+    // Pass characters through as they are, the program on the other end does its own line editing
+    struct termios attributes;
+    if(tcgetattr(master_fd, &attributes) == 0){
+        cfmakeraw(&attributes);
+        tcsetattr(master_fd, TCSANOW, &attributes);
+    }
+    if(!serial_port -> attachHost()){
+        Log::Warning() << "The serial port is already connected";
+        close(master_fd);
+        return nullptr;
+    }
+    terminal_name = ptsname(master_fd);
+    return new SerialBridge(serial_port, master_fd, master_fd, true);
+#else
+    Log::Warning() << "Pseudo-terminals aren't supported on this platform";
+    return nullptr;
+#endif
+}
+
+void SerialBridge::start(){
+    stopping = false;
+    reader = std::thread(&SerialBridge::readInput, this);
+    writer = std::thread(&SerialBridge::writeOutput, this);
+}
+
+void SerialBridge::stop(){
+    stopping = true;
+    if(reader.joinable()) reader.join();
+    if(writer.joinable()) writer.join();
+}
+
+void SerialBridge::readInput(){
+#ifdef Q_OS_UNIX
+    ACIA::ByteRing *ring = serial_port -> getReceiveRing();
+    uint8_t buffer[256];
+    ssize_t length = 0;
+    ssize_t sent = 0;
+    while(!stopping){
+        // Hand over what we have first, the processor takes it at the baud rate
+        while(sent < length && ring -> push(buffer[sent])) sent++;
+        if(sent < length){
+            std::this_thread::sleep_for(std::chrono::milliseconds(kPollIntervalMillis));
+            continue;
+        }
+
+        // Wait for more, but not forever so we notice when we're stopped
+        struct pollfd input = {input_fd, POLLIN, 0};
+        if(poll(&input, 1, kPollIntervalMillis) <= 0) continue;
+        length = read(input_fd, buffer, sizeof(buffer));
+        sent = 0;
+        // Nothing more will come once the input is closed
+        if(length == 0) return;
+        if(length < 0){
+            length = 0;
+            // A pseudo-terminal nobody has opened yet reads as an I/O error, try again later
+            if(errno != EIO && errno != EAGAIN && errno != EINTR) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(kPollIntervalMillis));
+        }
+    }
+#endif
+}
+
+void SerialBridge::writeOutput(){
+#ifdef Q_OS_UNIX
+    ACIA::ByteRing *ring = serial_port -> getTransmitRing();
+    uint8_t buffer[256];
+    while(!stopping){
+        // Write out everything that's waiting in one go
+        size_t length = 0;
+        while(length < sizeof(buffer) && ring -> pop(buffer[length])) length++;
+        if(length == 0){
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        size_t written = 0;
+        while(written < length && !stopping){
+            struct pollfd output = {output_fd, POLLOUT, 0};
+            if(poll(&output, 1, kPollIntervalMillis) <= 0) continue;
+            ssize_t result = write(output_fd, buffer + written, length - written);
+            // Whoever was reading is gone, drop what's left
+            if(result < 0) return;
+            written += result;
+        }
+    }
+#endif
+}
@@ -0,0 +1,87 @@
+#ifndef SERIALBRIDGE_H
+#define SERIALBRIDGE_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "acia.h"
+
+/**
+ * Connects the host side of the serial port to a pair of file descriptors, e.g. stdin and stdout
+ * or a pseudo-terminal
+ *
+ * Each direction gets a thread of its own, so a slow terminal or a read waiting for input only ever
+ * holds up the bridge, never the processor. The threads wake up every kPollInterval to see if they
+ * should stop
+ */
+class SerialBridge{
+public:
+    /**
+     * How long the threads wait for something to do before checking if they should stop
+     */
+    constexpr static int kPollIntervalMillis = 10;
+
+    /**
+     * @param serial_port The serial port to connect, its host side must not be attached to anything else
+     * @param input_fd Characters read from here are sent to the processor
+     * @param output_fd Characters the processor sends are written here
+     * @param owns_fds Whether to close the file descriptors when done
+     */
+    SerialBridge(ACIA *serial_port, int input_fd, int output_fd, bool owns_fds = false);
+    ~SerialBridge();
+
+    /**
+     * Connect the serial port to stdin and stdout
+     *
+     * @param serial_port
+     * @return The bridge, nullptr if the serial port is already connected to something else
+     */
+    static SerialBridge *openStdio(ACIA *serial_port);
+
+    /**
+     * Connect the serial port to a new pseudo-terminal, in raw mode
+     *
+     * @param serial_port
+     * @param terminal_name Set to the path of the terminal to connect to, e.g. with `screen`
+     * @return The bridge, nullptr if the serial port is already connected to something else or
+     *         pseudo-terminals aren't available
+     */
+    static SerialBridge *openPseudoTerminal(ACIA *serial_port, std::string &terminal_name);
+
+    /**
+     * Start moving characters
+     */
+    void start();
+
+    /**
+     * Stop moving characters and wait for the threads to finish
+     */
+    void stop();
+
+private:
+    /**
+     * Moves characters from the input to the serial port, on its own thread
+     */
+    void readInput();
+
+    /**
+     * Moves characters from the serial port to the output, on its own thread
+     */
+    void writeOutput();
+
+    ACIA *serial_port;
+    const int input_fd;
+    const int output_fd;
+    const bool owns_fds;
+
+    std::thread reader;
+    std::thread writer;
+
+    /**
+     * Tells the threads to finish
+     */
+    std::atomic<bool> stopping = false;
+};
+
+#endif // SERIALBRIDGE_H
@@ -0,0 +1,84 @@
+#include "serialconsole.h"
+
+#include <QKeyEvent>
+#include <QScrollBar>
+
+SerialConsole::SerialConsole(ACIA *serial_port, QWidget *parent) : QPlainTextEdit(parent), serial_port{serial_port}{
+    // The text can only be changed by the processor
+    setReadOnly(true);
+    setFont(QFont("Consolas"));
+    // Keep the scrollback from growing forever
+    setMaximumBlockCount(1000);
+
+    if(serial_port == nullptr){
+        setPlainText(tr("This machine has no serial port."));
+        return;
+    }
+    attached = serial_port -> attachHost();
+    if(!attached){
+        setPlainText(tr("The serial port is connected elsewhere."));
+        return;
+    }
+
+    refresh_timer = new QTimer(this);
+    connect(refresh_timer, &QTimer::timeout, this, &SerialConsole::receiveCharacters);
+    refresh_timer -> start(kRefreshMillis);
+}
+
+SerialConsole::~SerialConsole(){
+    if(attached) serial_port -> detachHost();
+}
+
+void SerialConsole::receiveCharacters(){
+    ACIA::ByteRing *ring = serial_port -> getTransmitRing();
+    if(ring -> empty()) return;
+
+    // Always write at the end, without moving the user's cursor or selection
+    QTextCursor end(document());
+    end.movePosition(QTextCursor::End);
+    QString received;
+    uint8_t character;
+    while(ring -> pop(character)){
+        switch(character){
+        case '\r':
+            // Line endings are usually CR LF, the LF does the work
+            break;
+        case 0x08:
+            // Backspace, take back the last character
+            if(!received.isEmpty()){
+                received.chop(1);
+            }else{
+                end.deletePreviousChar();
+            }
+            break;
+        default:
+            received += QChar(character);
+        }
+    }
+    end.insertText(received);
+    // Follow the output
+    verticalScrollBar() -> setValue(verticalScrollBar() -> maximum());
+}
+
+void SerialConsole::keyPressEvent(QKeyEvent *event){
+    // Let the usual shortcuts (copy, select all) through
+    if(!attached || event -> matches(QKeySequence::Copy) || event -> matches(QKeySequence::SelectAll)){
+        QPlainTextEdit::keyPressEvent(event);
+        return;
+    }
+
+    ACIA::ByteRing *ring = serial_port -> getReceiveRing();
+    switch(event -> key()){
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        ring -> push('\r');
+        return;
+    case Qt::Key_Backspace:
+        ring -> push(0x08);
+        return;
+    }
+    // If the processor isn't reading, what doesn't fit is dropped like on a real line
+    for(QChar character : event -> text()){
+        if(character.unicode() < 0x80) ring -> push(character.unicode());
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef SERIALCONSOLE_H
+#define SERIALCONSOLE_H
+
+#include <QPlainTextEdit>
+#include <QTimer>
+
+#include "acia.h"
+
+/**
+ * A terminal on the serial port
+ *
+ * Shows what the processor sends and sends what's typed into it. Characters go through the serial
+ * port's rings, polled by a timer on the UI thread, so a busy UI slows down the console and not
+ * the processor
+ */
+class SerialConsole : public QPlainTextEdit{
+    Q_OBJECT
+public:
+    /**
+     * How often the console picks up characters the processor sent
+     */
+    constexpr static int kRefreshMillis = 20;
+
+    /**
+     * @param serial_port The serial port to connect to. If something else is already connected the
+     *                    console just says so
+     * @param parent
+     */
+    explicit SerialConsole(ACIA *serial_port, QWidget *parent = nullptr);
+    ~SerialConsole();
+
+    /**
+     * Show the characters the processor sent since the last time
+     */
+    void receiveCharacters();
+
+protected:
+    /**
+     * Send typed characters to the processor instead of editing the text
+     */
+    void keyPressEvent(QKeyEvent *event) override;
+
+private:
+    ACIA *serial_port;
+
+    /**
+     * Whether we managed to attach to the serial port
+     */
+    bool attached;
+
+    /**
+     * Polls for characters the processor sent
+     */
+    QTimer *refresh_timer = nullptr;
+};
+
+#endif // SERIALCONSOLE_H
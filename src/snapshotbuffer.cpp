@@ -0,0 +1,26 @@
+#include "snapshotbuffer.h"
+
+SnapshotBuffer::SnapshotBuffer() : back_index{0}, middle_index{1}, front_index{2}, next_frame_number{0} {}
+
+MachineSnapshot *SnapshotBuffer::getWriteBuffer(){
+    return &buffers[back_index];
+}
+
+void SnapshotBuffer::publish(){
+    buffers[back_index].frame_number = next_frame_number++;
+    // Swap the freshly written buffer into the middle, and take whatever was there to write the next one
+    back_index = middle_index.exchange(back_index | kFreshBit, std::memory_order_acq_rel) & kIndexMask;
+}
+
+const MachineSnapshot *SnapshotBuffer::acquire(){
+    // If there is nothing new, keep the buffer we have
+    if(!(middle_index.load(std::memory_order_acquire) & kFreshBit)) return nullptr;
+    // Otherwise swap our buffer with the middle one
+    front_index = middle_index.exchange(front_index, std::memory_order_acq_rel) & kIndexMask;
+    return &buffers[front_index];
+}
+
+void SnapshotBuffer::reset(){
+    // Clear the fresh bit so the reader doesn't pick up a snapshot from a previous run
+    middle_index.fetch_and(kIndexMask, std::memory_order_acq_rel);
+}
@@ -0,0 +1,116 @@
+#ifndef SNAPSHOTBUFFER_H
+#define SNAPSHOTBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "vram.h"
+
+/**
+ * A consistent copy of the registers and the memory, taken between two instructions
+ */
+struct MachineSnapshot{
+    /**
+     * Size of the memory copy, covers the whole address space
+     */
+    constexpr static size_t kMemorySize = 0x10000;
+
+    /**
+     * Increases by one every time a snapshot is published
+     */
+    uint64_t frame_number = 0;
+
+    uint16_t PC = 0;
+    uint8_t S = 0;
+    uint8_t P = 0;
+    uint8_t A = 0;
+    uint8_t X = 0;
+    uint8_t Y = 0;
+
+    uint8_t memory[kMemorySize];
+
+    /**
+     * What's on the display
+     */
+    FrameSnapshot frame;
+};
+
+/**
+ * Lock-free triple buffer used to hand `MachineSnapshot`s from the run worker to the UI
+ *
+ * There is exactly one writer (the CPU thread) and one reader (the UI thread.) The writer
+ * always has a buffer of its own to fill in and publishing is a single atomic exchange, so
+ * the CPU thread never waits for the UI. The reader always gets the latest complete
+ * snapshot, older ones it didn't pick up in time are simply overwritten.
+ */
+class SnapshotBuffer{
+public:
+    SnapshotBuffer();
+
+    /**
+     * Get the buffer the next snapshot should be written into
+     *
+     * Writer side only
+     *
+     * @return The buffer, owned by the writer until publish() is called
+     */
+    MachineSnapshot *getWriteBuffer();
+
+    /**
+     * Publish the buffer returned by getWriteBuffer() as the latest snapshot
+     *
+     * Writer side only, never blocks
+     */
+    void publish();
+
+    /**
+     * Grab the latest published snapshot, if the reader hasn't seen it yet
+     *
+     * Reader side only
+     *
+     * @return The snapshot, valid until the next call to acquire(). nullptr if nothing new was published
+     */
+    const MachineSnapshot *acquire();
+
+    /**
+     * Drop any published snapshot that wasn't picked up yet
+     *
+     * Must only be called while there is no writer (i.e. the processor isn't running)
+     */
+    void reset();
+
+private:
+    /**
+     * Set in `middle` when it holds a snapshot the reader hasn't picked up yet
+     */
+    constexpr static uint8_t kFreshBit = 0x4;
+    constexpr static uint8_t kIndexMask = 0x3;
+
+    /**
+     * The three buffers, each of them is either owned by the writer, the reader, or is waiting in the middle
+     */
+    MachineSnapshot buffers[3];
+
+    /**
+     * Index of the buffer being written to, writer side only
+     */
+    uint8_t back_index;
+
+    /**
+     * Index of the latest published buffer, along with kFreshBit
+     */
+    std::atomic<uint8_t> middle_index;
+
+    /**
+     * Index of the buffer being read from, reader side only
+     */
+    uint8_t front_index;
+
+    /**
+     * Number of the next frame to be published
+     */
+    uint64_t next_frame_number;
+};
+
+#endif // SNAPSHOTBUFFER_H
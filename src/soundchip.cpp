@@ -0,0 +1,45 @@
+#include "soundchip.h"
+
+SoundChip::SoundChip(uint16_t base_address) : MemoryMappedDevice(base_address, kRegisterCount){
+    // Register writes are stamped with the cycle they happen on
+    needs_sync = true;
+}
+
+void SoundChip::sync(uint64_t cycle){
+    current_cycle = cycle;
+}
+
+bool SoundChip::setValue(uint16_t address, uint8_t value){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return false;
+
+    registers[relative_address] = value;
+    if(logging && !event_log.push({current_cycle, (uint8_t) relative_address, value})){
+        dropped_events.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+uint8_t SoundChip::getValue(uint16_t address){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+    return registers[relative_address];
+}
+
+void SoundChip::setLogging(bool logging){
+    this -> logging = logging;
+}
+
+SoundChip::EventLog *SoundChip::getEventLog(){
+    return &event_log;
+}
+
+uint8_t SoundChip::getRegister(uint8_t reg){
+    return registers[reg % kRegisterCount];
+}
+
+uint64_t SoundChip::getDroppedEvents(){
+    return dropped_events;
+}
@@ -0,0 +1,109 @@
+#ifndef SOUNDCHIP_H
+#define SOUNDCHIP_H
+
+#include <atomic>
+
+#include "memorymappeddevice.h"
+#include "spscring.h"
+
+/**
+ * A register write on the sound chip, or a time marker, stamped with the bus cycle it happened on
+ */
+struct SoundEvent{
+    /**
+     * Register number of a time marker, which only says that the audio up to its cycle is final
+     */
+    constexpr static uint8_t kTimeMarker = 0xFF;
+
+    uint64_t cycle;
+    uint8_t reg;
+    uint8_t value;
+};
+
+/**
+ * A simple programmable sound generator: three square wave tone channels and a noise channel, in the
+ * spirit of the SN76489
+ *
+ * The chip doesn't make any sound itself. While something is listening, every register write is
+ * logged with its bus cycle into a ring, and the listener (a SoundRecorder) synthesises the audio on
+ * its own thread from the log. Writing a register costs the CPU thread one push, however much audio
+ * comes out of it
+ */
+class SoundChip : public MemoryMappedDevice{
+public:
+    /**
+     * The registers, relative to the base address
+     */
+    enum Register{
+        TONE0_LOW = 0x0, // Tone periods, in units of 16 cycles per half wave, 16 bits
+        TONE0_HIGH = 0x1,
+        TONE1_LOW = 0x2,
+        TONE1_HIGH = 0x3,
+        TONE2_LOW = 0x4,
+        TONE2_HIGH = 0x5,
+        NOISE = 0x6, // Bits 0-1 shift rate (512, 1024, 2048 cycles or tone 2), bit 2 white noise instead of periodic
+        VOLUME0 = 0x7, // Volumes, 0 is off and 15 the loudest
+        VOLUME1 = 0x8,
+        VOLUME2 = 0x9,
+        VOLUME_NOISE = 0xA
+    };
+
+    /**
+     * Number of registers
+     */
+    constexpr static size_t kRegisterCount = 0x10;
+
+    /**
+     * How many events can be waiting for the listener
+     */
+    constexpr static size_t kEventLogSize = 8192;
+
+    typedef SPSCRing<SoundEvent, kEventLogSize> EventLog;
+
+    SoundChip(uint16_t base_address);
+
+    bool setValue(uint16_t address, uint8_t value) override;
+    uint8_t getValue(uint16_t address) override;
+    void sync(uint64_t cycle) override;
+
+    /**
+     * Start or stop logging register writes for a listener
+     *
+     * Must be called while the processor isn't running
+     *
+     * @param logging
+     */
+    void setLogging(bool logging);
+
+    /**
+     * The log of register writes, the listener pops them
+     */
+    EventLog *getEventLog();
+
+    /**
+     * Get the current value of a register
+     *
+     * @param reg
+     */
+    uint8_t getRegister(uint8_t reg);
+
+    /**
+     * How many register writes didn't fit in the log because the listener fell behind, safe to call
+     * from any thread
+     */
+    uint64_t getDroppedEvents();
+
+private:
+    /**
+     * The bus cycle we've been synced to
+     */
+    uint64_t current_cycle = 0;
+
+    uint8_t registers[kRegisterCount] = {};
+
+    bool logging = false;
+    EventLog event_log;
+    std::atomic<uint64_t> dropped_events = 0;
+};
+
+#endif // SOUNDCHIP_H
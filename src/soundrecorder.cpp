@@ -0,0 +1,224 @@
+#include "soundrecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+SoundRecorder::SoundRecorder(SoundChip *sound_chip, EventScheduler *scheduler, int clock_speed) : sound_chip{sound_chip},
+                                                                                                 scheduler{scheduler},
+                                                                                                 clock_speed{std::max(1, clock_speed)}{
+    // Four channels at full volume just fit in 16 bits
+    volume_table[0] = 0;
+    for(int volume = 1; volume < 16; volume++){
+        volume_table[volume] = (int32_t) (8191 * std::pow(10.0, -2.0 * (15 - volume) / 20));
+    }
+}
+
+SoundRecorder::~SoundRecorder(){
+    // Keep what's been synthesised so far
+    if(output != nullptr) stop(start_cycle);
+}
+
+bool SoundRecorder::start(std::string path, uint64_t start_cycle){
+    output = fopen(path.c_str(), "wb");
+    if(output == nullptr) return false;
+    this -> start_cycle = start_cycle;
+    samples_written = 0;
+    // The sizes are filled in when we're done
+    writeHeader();
+
+    // Start from whatever the chip is set to right now
+    for(uint8_t reg = 0; reg < SoundChip::kRegisterCount; reg++){
+        applyRegister(reg, sound_chip -> getRegister(reg));
+    }
+    sound_chip -> setLogging(true);
+
+    stopping = false;
+    writer = std::thread(&SoundRecorder::synthesise, this);
+    markTime(start_cycle);
+    return true;
+}
+
+void SoundRecorder::stop(uint64_t end_cycle){
+    if(marker_event_pending) scheduler -> cancel(marker_event);
+    marker_event_pending = false;
+
+    // Everything up to now is final. The processor isn't running, so waiting for room is fine
+    while(!sound_chip -> getEventLog() -> push({end_cycle, SoundEvent::kTimeMarker, 0})){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    sound_chip -> setLogging(false);
+    stopping = true;
+    if(writer.joinable()) writer.join();
+
+    // Now that we know how long it is, fill in the header
+    fseek(output, 0, SEEK_SET);
+    writeHeader();
+    fclose(output);
+    output = nullptr;
+}
+
+uint64_t SoundRecorder::getSamplesWritten(){
+    return samples_written;
+}
+
+void SoundRecorder::markTime(uint64_t deadline){
+    // If the log is full the next marker covers this one
+    if(deadline != start_cycle) sound_chip -> getEventLog() -> push({deadline, SoundEvent::kTimeMarker, 0});
+
+    uint64_t next_deadline = deadline + std::max<uint64_t>(1, clock_speed * kMarkerInterval);
+    marker_event = scheduler -> schedule(next_deadline, [this, next_deadline](uint64_t){ markTime(next_deadline); });
+    marker_event_pending = true;
+}
+
+void SoundRecorder::synthesise(){
+    SoundChip::EventLog *event_log = sound_chip -> getEventLog();
+    while(true){
+        // Look at this before emptying the log, so whatever was logged before stop() is played
+        bool finishing = stopping;
+        bool played_any = false;
+        SoundEvent event;
+        while(event_log -> pop(event)){
+            // Play up to the event with the registers as they were, then apply it
+            renderUntil(event.cycle);
+            if(event.reg != SoundEvent::kTimeMarker) applyRegister(event.reg, event.value);
+            played_any = true;
+        }
+        if(finishing) break;
+        if(!played_any) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void SoundRecorder::renderUntil(uint64_t cycle){
+    if(cycle <= start_cycle) return;
+    uint64_t target = (cycle - start_cycle) * kSampleRate / clock_speed;
+    while(samples_written < target){
+        renderBlock((int) std::min<uint64_t>(kBlockSamples, target - samples_written));
+    }
+}
+
+void SoundRecorder::renderBlock(int samples){
+    std::fill(mix, mix + samples, 0);
+
+    // The square waves. Each sample only depends on its index, so these loops vectorise
+    for(ToneChannel &tone : tones){
+        if(tone.increment == 0 || tone.amplitude == 0) continue;
+        const uint32_t phase = tone.phase;
+        const uint32_t increment = tone.increment;
+        const int32_t amplitude = tone.amplitude;
+        for(int sample = 0; sample < samples; sample++){
+            uint32_t sample_phase = phase + (uint32_t) sample * increment;
+            mix[sample] += (sample_phase & 0x80000000) ? -amplitude : amplitude;
+        }
+        tone.phase = phase + (uint32_t) samples * increment;
+    }
+
+    // The noise has to be shifted one step at a time
+    if(noise_amplitude != 0 && noise_increment != 0){
+        bool white = registers[SoundChip::NOISE] & 0x04;
+        for(int sample = 0; sample < samples; sample++){
+            noise_phase += noise_increment;
+            for(; noise_phase >= (1ull << 32); noise_phase -= 1ull << 32){
+                uint16_t feedback = white ? ((noise_shift_register ^ (noise_shift_register >> 1)) & 1) : (noise_shift_register & 1);
+                noise_shift_register = (noise_shift_register >> 1) | (feedback << 14);
+            }
+            mix[sample] += (noise_shift_register & 1) ? noise_amplitude : -noise_amplitude;
+        }
+    }
+
+    // 16-bit little endian
+    for(int sample = 0; sample < samples; sample++){
+        int32_t value = std::clamp(mix[sample], -32768, 32767);
+        block[sample * 2] = value & 0xFF;
+        block[sample * 2 + 1] = (value >> 8) & 0xFF;
+    }
+    fwrite(block, 2, samples, output);
+    samples_written += samples;
+}
+
+void SoundRecorder::applyRegister(uint8_t reg, uint8_t value){
+    registers[reg] = value;
+    switch(reg){
+    case SoundChip::TONE0_LOW:
+    case SoundChip::TONE0_HIGH:
+        updateToneIncrement(0);
+        break;
+    case SoundChip::TONE1_LOW:
+    case SoundChip::TONE1_HIGH:
+        updateToneIncrement(1);
+        break;
+    case SoundChip::TONE2_LOW:
+    case SoundChip::TONE2_HIGH:
+        updateToneIncrement(2);
+        // The noise can be clocked by tone 2
+        updateNoiseIncrement();
+        break;
+    case SoundChip::NOISE:
+        // Writing the noise register restarts the noise
+        noise_shift_register = 0x4000;
+        updateNoiseIncrement();
+        break;
+    case SoundChip::VOLUME0:
+    case SoundChip::VOLUME1:
+    case SoundChip::VOLUME2:
+        tones[reg - SoundChip::VOLUME0].amplitude = volume_table[value & 0x0F];
+        break;
+    case SoundChip::VOLUME_NOISE:
+        noise_amplitude = volume_table[value & 0x0F];
+        break;
+    }
+}
+
+void SoundRecorder::updateToneIncrement(int channel){
+    uint32_t period = registers[SoundChip::TONE0_LOW + channel * 2] | (registers[SoundChip::TONE0_HIGH + channel * 2] << 8);
+    // A full wave is 32 cycles per unit of period
+    double frequency = (double) clock_speed / (32.0 * std::max<uint32_t>(1, period));
+    // Tones we can't represent at this sample rate are left out rather than aliased
+    tones[channel].increment = frequency < kSampleRate / 2 ? (uint32_t) (frequency / kSampleRate * 4294967296.0) : 0;
+}
+
+void SoundRecorder::updateNoiseIncrement(){
+    double shift_cycles;
+    switch(registers[SoundChip::NOISE] & 0x03){
+    case 0:
+        shift_cycles = 512;
+        break;
+    case 1:
+        shift_cycles = 1024;
+        break;
+    case 2:
+        shift_cycles = 2048;
+        break;
+    default:
+        // Every half wave of tone 2
+        uint32_t period = registers[SoundChip::TONE2_LOW] | (registers[SoundChip::TONE2_HIGH] << 8);
+        shift_cycles = 16.0 * std::max<uint32_t>(1, period);
+    }
+    noise_increment = (uint64_t) ((double) clock_speed / shift_cycles / kSampleRate * 4294967296.0);
+}
+
+void SoundRecorder::writeHeader(){
+    uint32_t data_size = samples_written * 2;
+    uint8_t header[44];
+    auto put16 = [&header](int offset, uint16_t value){
+        header[offset] = value & 0xFF;
+        header[offset + 1] = value >> 8;
+    };
+    auto put32 = [&header](int offset, uint32_t value){
+        for(int i = 0; i < 4; i++) header[offset + i] = (value >> (8 * i)) & 0xFF;
+    };
+    memcpy(header, "RIFF", 4);
+    put32(4, 36 + data_size);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put32(16, 16); // Size of the format chunk
+    put16(20, 1); // PCM
+    put16(22, 1); // Mono
+    put32(24, kSampleRate);
+    put32(28, kSampleRate * 2); // Bytes per second
+    put16(32, 2); // Bytes per sample
+    put16(34, 16); // Bits per sample
+    memcpy(header + 36, "data", 4);
+    put32(40, data_size);
+    fwrite(header, 1, sizeof(header), output);
+}
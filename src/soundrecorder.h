@@ -0,0 +1,190 @@
+#ifndef SOUNDRECORDER_H
+#define SOUNDRECORDER_H
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "eventscheduler.h"
+#include "soundchip.h"
+
+/**
+ * Synthesises what the sound chip plays into a WAV file, on its own thread
+ *
+ * Time is counted in bus cycles and converted with the clock speed the recording started at, so the
+ * same program gives the same file however fast the host runs it. A scheduled event marks every
+ * kMarkerInterval how far the audio is final, and the writer synthesises up to there in blocks,
+ * applying each register write at the sample it happened on. The work done grows with the number
+ * of samples written, not with the number of cycles run
+ */
+class SoundRecorder{
+public:
+    /**
+     * Output sample rate, mono 16-bit
+     */
+    constexpr static int kSampleRate = 44100;
+
+    /**
+     * How many samples are synthesised at a time
+     */
+    constexpr static int kBlockSamples = 512;
+
+    /**
+     * How often, in emulated seconds, the audio so far is marked final
+     */
+    constexpr static double kMarkerInterval = 0.01;
+
+    /**
+     * @param sound_chip The chip to record
+     * @param scheduler The scheduler the time markers are set with
+     * @param clock_speed The processor clock, in Hz
+     */
+    SoundRecorder(SoundChip *sound_chip, EventScheduler *scheduler, int clock_speed);
+    ~SoundRecorder();
+
+    /**
+     * Open the output file and start recording from the given cycle
+     *
+     * Must be called while the processor isn't running
+     *
+     * @param path
+     * @param start_cycle The current bus cycle
+     * @return false if the file can't be opened
+     */
+    bool start(std::string path, uint64_t start_cycle);
+
+    /**
+     * Synthesise everything up to the given cycle, finish the file and close it
+     *
+     * Must be called while the processor isn't running
+     *
+     * @param end_cycle The current bus cycle
+     */
+    void stop(uint64_t end_cycle);
+
+    /**
+     * Samples written so far, safe to call from any thread
+     */
+    uint64_t getSamplesWritten();
+
+private:
+    /**
+     * The state of a tone channel's oscillator
+     */
+    struct ToneChannel{
+        /**
+         * Position in the wave, a full wave is 2^32. The top bit says which half we're in
+         */
+        uint32_t phase = 0;
+
+        /**
+         * How far the phase moves per sample, 0 if the tone is too high to play
+         */
+        uint32_t increment = 0;
+
+        int32_t amplitude = 0;
+    };
+
+    /**
+     * Set a time marker and schedule the next one
+     *
+     * @param deadline The cycle this marker was due on
+     */
+    void markTime(uint64_t deadline);
+
+    /**
+     * Synthesise what's in the event log until stopped, on its own thread
+     */
+    void synthesise();
+
+    /**
+     * Synthesise and write the samples up to the given cycle
+     *
+     * @param cycle
+     */
+    void renderUntil(uint64_t cycle);
+
+    /**
+     * Synthesise and write the given number of samples with the current registers
+     *
+     * @param samples At most kBlockSamples
+     */
+    void renderBlock(int samples);
+
+    /**
+     * Bring the oscillators up to date with a register write
+     *
+     * @param reg
+     * @param value
+     */
+    void applyRegister(uint8_t reg, uint8_t value);
+
+    /**
+     * Work out the phase increment of a tone channel from its period
+     *
+     * @param channel
+     */
+    void updateToneIncrement(int channel);
+
+    /**
+     * Work out how often the noise shifts from its register (and tone 2)
+     */
+    void updateNoiseIncrement();
+
+    /**
+     * Write the WAV header, with the sizes filled in for the samples written so far
+     */
+    void writeHeader();
+
+    SoundChip *sound_chip;
+    EventScheduler *scheduler;
+    const int clock_speed;
+
+    FILE *output = nullptr;
+
+    /**
+     * The cycle the recording started on
+     */
+    uint64_t start_cycle = 0;
+
+    /**
+     * The pending time marker
+     */
+    EventScheduler::EventId marker_event = 0;
+    bool marker_event_pending = false;
+
+    std::thread writer;
+    std::atomic<bool> stopping = false;
+
+    std::atomic<uint64_t> samples_written = 0;
+
+    /**
+     * The registers, as of the sample being synthesised. Writer thread only from here on
+     */
+    uint8_t registers[SoundChip::kRegisterCount] = {};
+
+    ToneChannel tones[3];
+
+    /**
+     * The noise channel: a linear feedback shift register, shifted every time its phase passes a
+     * whole number. The phase and its increment per sample are 32.32 fixed point
+     */
+    uint16_t noise_shift_register = 0x4000;
+    uint64_t noise_phase = 0;
+    uint64_t noise_increment = 0;
+    int32_t noise_amplitude = 0;
+
+    /**
+     * Amplitude of each volume setting, 2dB apart
+     */
+    int32_t volume_table[16];
+
+    /**
+     * A block of samples being put together
+     */
+    int32_t mix[kBlockSamples];
+    uint8_t block[kBlockSamples * 2];
+};
+
+#endif // SOUNDRECORDER_H
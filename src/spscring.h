@@ -0,0 +1,94 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Lock-free ring buffer with exactly one producer thread and one consumer thread
+ *
+ * Neither side ever waits for the other, push() fails when the ring is full and pop() when it's
+ * empty, so whoever is on the emulator side can't be held up by whatever is on the host side.
+ * Each side keeps a cached copy of the other side's index and only reloads it when the cache says
+ * the ring is full (or empty), so the indices don't bounce between cores on every element
+ *
+ * @tparam T The element type
+ * @tparam kCapacity How many elements fit, must be a power of two
+ */
+template<typename T, size_t kCapacity>
+class SPSCRing{
+    static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0, "The capacity must be a power of two");
+public:
+    /**
+     * Add an element, producer side only
+     *
+     * @param value
+     * @return false if the ring is full, the element isn't added then
+     */
+    bool push(const T &value){
+        size_t tail = write_index.load(std::memory_order_relaxed);
+        if(tail - cached_read_index == kCapacity){
+            cached_read_index = read_index.load(std::memory_order_acquire);
+            if(tail - cached_read_index == kCapacity) return false;
+        }
+        elements[tail & (kCapacity - 1)] = value;
+        write_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take the oldest element, consumer side only
+     *
+     * @param value Set to the element
+     * @return false if the ring is empty
+     */
+    bool pop(T &value){
+        size_t head = read_index.load(std::memory_order_relaxed);
+        if(head == cached_write_index){
+            cached_write_index = write_index.load(std::memory_order_acquire);
+            if(head == cached_write_index) return false;
+        }
+        value = elements[head & (kCapacity - 1)];
+        read_index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Whether there is anything to pop, consumer side only
+     */
+    bool empty(){
+        return read_index.load(std::memory_order_relaxed) == write_index.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Roughly how many elements are in the ring, can be called from anywhere
+     */
+    size_t size(){
+        return write_index.load(std::memory_order_acquire) - read_index.load(std::memory_order_acquire);
+    }
+
+private:
+    /**
+     * The index the next element is written to, owned by the producer. Never wraps, it's masked on use
+     */
+    alignas(64) std::atomic<size_t> write_index = 0;
+
+    /**
+     * The producer's copy of read_index
+     */
+    size_t cached_read_index = 0;
+
+    /**
+     * The index the next element is read from, owned by the consumer
+     */
+    alignas(64) std::atomic<size_t> read_index = 0;
+
+    /**
+     * The consumer's copy of write_index
+     */
+    size_t cached_write_index = 0;
+
+    alignas(64) T elements[kCapacity];
+};
+
+#endif // SPSCRING_H
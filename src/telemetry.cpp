@@ -0,0 +1,96 @@
+#include "telemetry.h"
+
+Telemetry::Telemetry() : sequence{0}, cycles_executed{0}, instructions_retired{0}, interrupts_taken{0},
+                         effective_clock_speed{0}, effective_instruction_rate{0}, throttle_error{0}, stop_latency_nanos{0}, input_latency_nanos{0}, window_head{0}, window_size{0} {}
+
+void Telemetry::record(std::chrono::steady_clock::time_point now, uint64_t cycles_executed, uint64_t instructions_retired,
+                       uint64_t interrupts_taken, double target_clock_speed, bool force){
+    // Most calls end here, keep it cheap
+    if(now < next_sample_time && !force) return;
+    next_sample_time = now + kSampleInterval;
+
+    // Push the new entry into the window, dropping the oldest one if it's full
+    window_head = (window_head + 1) % kWindowLength;
+    window[window_head] = WindowEntry{now, cycles_executed, instructions_retired};
+    if(window_size < kWindowLength) window_size++;
+
+    TelemetrySample sample = latest_sample;
+    sample.cycles_executed = cycles_executed;
+    sample.instructions_retired = instructions_retired;
+    sample.interrupts_taken = interrupts_taken;
+
+    // The effective rates are calculated between the oldest and the newest entries in the window
+    const WindowEntry &oldest = window[(window_head - window_size + 1 + kWindowLength) % kWindowLength];
+    double window_nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(now - oldest.time).count();
+    if(window_nanos > 0){
+        sample.effective_clock_speed = 1e9 * (cycles_executed - oldest.cycles_executed) / window_nanos;
+        sample.effective_instruction_rate = 1e9 * (instructions_retired - oldest.instructions_retired) / window_nanos;
+    }
+    sample.throttle_error = 0;
+    if(target_clock_speed > 0 && sample.effective_clock_speed > 0){
+        sample.throttle_error = (sample.effective_clock_speed - target_clock_speed) / target_clock_speed;
+    }
+
+    publish(sample);
+}
+
+void Telemetry::publishStopLatency(std::chrono::nanoseconds stop_latency){
+    latest_sample.stop_latency_nanos = stop_latency.count();
+    publish(latest_sample);
+}
+
+void Telemetry::recordInputLatency(std::chrono::nanoseconds input_latency){
+    latest_sample.input_latency_nanos = input_latency.count();
+}
+
+void Telemetry::reset(){
+    window_head = 0;
+    window_size = 0;
+    next_sample_time = std::chrono::steady_clock::time_point();
+    // The latencies are about the previous run, keep them around
+    TelemetrySample sample;
+    sample.stop_latency_nanos = latest_sample.stop_latency_nanos;
+    sample.input_latency_nanos = latest_sample.input_latency_nanos;
+    publish(sample);
+}
+
+void Telemetry::publish(const TelemetrySample &sample){
+    latest_sample = sample;
+
+    // Mark the sample as being written
+    uint32_t start_sequence = sequence.load(std::memory_order_relaxed);
+    sequence.store(start_sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    cycles_executed.store(sample.cycles_executed, std::memory_order_relaxed);
+    instructions_retired.store(sample.instructions_retired, std::memory_order_relaxed);
+    interrupts_taken.store(sample.interrupts_taken, std::memory_order_relaxed);
+    effective_clock_speed.store(sample.effective_clock_speed, std::memory_order_relaxed);
+    effective_instruction_rate.store(sample.effective_instruction_rate, std::memory_order_relaxed);
+    throttle_error.store(sample.throttle_error, std::memory_order_relaxed);
+    stop_latency_nanos.store(sample.stop_latency_nanos, std::memory_order_relaxed);
+    input_latency_nanos.store(sample.input_latency_nanos, std::memory_order_relaxed);
+
+    // Mark it as done
+    sequence.store(start_sequence + 2, std::memory_order_release);
+}
+
+TelemetrySample Telemetry::read() const{
+    TelemetrySample sample;
+    uint32_t start_sequence, end_sequence;
+    // Retry until we read a sample the writer didn't touch while we were reading it
+    do{
+        start_sequence = sequence.load(std::memory_order_acquire);
+        sample.cycles_executed = cycles_executed.load(std::memory_order_relaxed);
+        sample.instructions_retired = instructions_retired.load(std::memory_order_relaxed);
+        sample.interrupts_taken = interrupts_taken.load(std::memory_order_relaxed);
+        sample.effective_clock_speed = effective_clock_speed.load(std::memory_order_relaxed);
+        sample.effective_instruction_rate = effective_instruction_rate.load(std::memory_order_relaxed);
+        sample.throttle_error = throttle_error.load(std::memory_order_relaxed);
+        sample.stop_latency_nanos = stop_latency_nanos.load(std::memory_order_relaxed);
+        sample.input_latency_nanos = input_latency_nanos.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        end_sequence = sequence.load(std::memory_order_relaxed);
+    }while((start_sequence & 1) || start_sequence != end_sequence);
+    return sample;
+}
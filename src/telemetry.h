@@ -0,0 +1,174 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * A consistent set of run-time statistics, as read from `Telemetry`
+ */
+struct TelemetrySample{
+    /**
+     * Cycles executed since the processor started running
+     */
+    uint64_t cycles_executed = 0;
+
+    /**
+     * Instructions executed since the processor started running
+     */
+    uint64_t instructions_retired = 0;
+
+    /**
+     * IRQs and NMIs serviced since the processor started running
+     */
+    uint64_t interrupts_taken = 0;
+
+    /**
+     * Clock speed the processor actually ran at over the sliding window, in Hz
+     */
+    double effective_clock_speed = 0;
+
+    /**
+     * Instructions executed per second of host time over the sliding window
+     */
+    double effective_instruction_rate = 0;
+
+    /**
+     * How far off the effective clock speed is from the target, relative to the target
+     * (e.g. -0.01 means 1% too slow.) 0 if there is no target
+     */
+    double throttle_error = 0;
+
+    /**
+     * How long the processor took to stop the last time it was asked to, in nanoseconds
+     */
+    uint64_t stop_latency_nanos = 0;
+
+    /**
+     * How long it took from the last key being typed until the first live view snapshot after the
+     * processor read it, in nanoseconds. 0 if no key has been read yet
+     */
+    uint64_t input_latency_nanos = 0;
+};
+
+/**
+ * Run-time statistics published by the run worker
+ *
+ * The worker is the only writer and publishes through a seqlock, so readers on any
+ * thread (the UI, the headless stats dump) always get a consistent `TelemetrySample`
+ * without the writer ever waiting on them. The writer only publishes every
+ * kSampleInterval, so record() can be called from the hot loop.
+ */
+class Telemetry{
+public:
+    Telemetry();
+
+    /**
+     * How often a new sample is published
+     */
+    constexpr static std::chrono::milliseconds kSampleInterval{50};
+
+    /**
+     * Number of samples in the sliding window the effective clock speed is calculated over
+     */
+    constexpr static int kWindowLength = 20;
+
+    /**
+     * Record the current counters, publishing them if kSampleInterval has passed since the last time
+     *
+     * Writer side only
+     *
+     * @param now The current time
+     * @param cycles_executed
+     * @param instructions_retired
+     * @param interrupts_taken
+     * @param target_clock_speed The speed the processor is trying to run at, 0 if unthrottled
+     * @param force Publish right away, regardless of when the last sample was published
+     */
+    void record(std::chrono::steady_clock::time_point now, uint64_t cycles_executed, uint64_t instructions_retired,
+                uint64_t interrupts_taken, double target_clock_speed, bool force = false);
+
+    /**
+     * Publish how long the processor took to stop, along with the last recorded sample
+     *
+     * Must only be called while there is no writer (i.e. once the processor has stopped)
+     *
+     * @param stop_latency
+     */
+    void publishStopLatency(std::chrono::nanoseconds stop_latency);
+
+    /**
+     * Record the latest input latency, it's published with the next sample
+     *
+     * Writer side only
+     *
+     * @param input_latency
+     */
+    void recordInputLatency(std::chrono::nanoseconds input_latency);
+
+    /**
+     * Zero the statistics and clear the sliding window
+     *
+     * Must only be called while there is no writer (i.e. the processor isn't running)
+     */
+    void reset();
+
+    /**
+     * Read the latest published statistics. Never sees a half-written sample
+     *
+     * @return The statistics
+     */
+    TelemetrySample read() const;
+
+private:
+    /**
+     * Publish a sample through the seqlock
+     *
+     * @param sample
+     */
+    void publish(const TelemetrySample &sample);
+
+    /**
+     * Odd while the writer is in the middle of publishing
+     */
+    std::atomic<uint32_t> sequence;
+
+    // The published values, only consistent when read through read()
+    std::atomic<uint64_t> cycles_executed;
+    std::atomic<uint64_t> instructions_retired;
+    std::atomic<uint64_t> interrupts_taken;
+    std::atomic<double> effective_clock_speed;
+    std::atomic<double> effective_instruction_rate;
+    std::atomic<double> throttle_error;
+    std::atomic<uint64_t> stop_latency_nanos;
+    std::atomic<uint64_t> input_latency_nanos;
+
+    /**
+     * The last sample published, writer side only
+     */
+    TelemetrySample latest_sample;
+
+    /**
+     * An entry in the sliding window, writer side only
+     */
+    struct WindowEntry{
+        std::chrono::steady_clock::time_point time;
+        uint64_t cycles_executed;
+        uint64_t instructions_retired;
+    };
+
+    /**
+     * Ring buffer of the last kWindowLength samples, writer side only
+     */
+    WindowEntry window[kWindowLength];
+    int window_head;
+    int window_size;
+
+    /**
+     * When the next sample should be published, writer side only
+     */
+    std::chrono::steady_clock::time_point next_sample_time;
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,264 @@
+#include "via.h"
+
+VIA::VIA(uint16_t base_address, EventScheduler *scheduler, InterruptController *interrupt_controller) : MemoryMappedDevice(base_address, kRegisterCount),
+                                                                                                        scheduler{scheduler},
+                                                                                                        interrupt_controller{interrupt_controller}{
+    irq_line = interrupt_controller -> allocateLine();
+    // The timers are worked out from the current cycle when they're accessed
+    needs_sync = true;
+}
+
+VIA::~VIA(){
+    // Don't leave callbacks to us behind
+    if(t1_event_pending) scheduler -> cancel(t1_event);
+    if(t2_event_pending) scheduler -> cancel(t2_event);
+    if(shift_event_pending) scheduler -> cancel(shift_event);
+    interrupt_controller -> lowerIRQ(irq_line);
+}
+
+void VIA::sync(uint64_t cycle){
+    current_cycle = cycle;
+}
+
+void VIA::setPortAInput(uint8_t value){
+    port_a_input = value;
+}
+
+void VIA::setPortBInput(uint8_t value){
+    port_b_input = value;
+}
+
+bool VIA::setValue(uint16_t address, uint8_t value){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return false;
+
+    switch(relative_address){
+    case ORB:
+        orb = value;
+        clearFlags(CB1_FLAG | CB2_FLAG);
+        break;
+    case ORA:
+        ora = value;
+        clearFlags(CA1_FLAG | CA2_FLAG);
+        break;
+    case ORA_NO_HANDSHAKE:
+        ora = value;
+        break;
+    case DDRB:
+        ddrb = value;
+        break;
+    case DDRA:
+        ddra = value;
+        break;
+    case T1C_L:
+    case T1L_L:
+        t1_latch = (t1_latch & 0xFF00) | value;
+        break;
+    case T1C_H:
+        // Writing the high counter loads the counter from the latches and starts the timer
+        t1_latch = (t1_latch & 0x00FF) | (value << 8);
+        clearFlags(TIMER1_FLAG);
+        startTimer1();
+        break;
+    case T1L_H:
+        t1_latch = (t1_latch & 0x00FF) | (value << 8);
+        clearFlags(TIMER1_FLAG);
+        break;
+    case T2C_L:
+        t2_latch_low = value;
+        break;
+    case T2C_H:
+        // Timer 2 only interrupts once per load
+        t2_load_cycle = current_cycle;
+        t2_load_value = t2_latch_low | (value << 8);
+        clearFlags(TIMER2_FLAG);
+        if(t2_event_pending) scheduler -> cancel(t2_event);
+        t2_event_pending = false;
+        // In pulse counting mode the counter waits for PB6, which nothing drives
+        if(!(acr & 0x20)){
+            t2_event = scheduler -> schedule(t2_load_cycle + t2_load_value + 1, [this](uint64_t){
+                t2_event_pending = false;
+                setFlags(TIMER2_FLAG);
+            });
+            t2_event_pending = true;
+        }
+        break;
+    case SR:
+        sr = value;
+        startShift();
+        break;
+    case ACR:
+        acr = value;
+        break;
+    case PCR:
+        pcr = value;
+        break;
+    case IFR:
+        // Writing ones clears the corresponding flags
+        clearFlags(value & 0x7F);
+        break;
+    case IER:
+        // Bit 7 says whether the other set bits enable or disable their interrupts
+        if(value & 0x80) ier |= value & 0x7F;
+        else ier &= ~value;
+        updateIRQ();
+        break;
+    }
+    return true;
+}
+
+uint8_t VIA::getValue(uint16_t address){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+    return readRegister(relative_address, true);
+}
+
+uint8_t VIA::peekValue(uint16_t address){
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+    return readRegister(relative_address, false);
+}
+
+uint8_t VIA::readRegister(uint8_t reg, bool side_effects){
+    switch(reg){
+    case ORB:{
+        // Output pins read back what we drive, input pins what's driven onto them
+        uint8_t value = (orb & ddrb) | (port_b_input & ~ddrb);
+        if(acr & 0x80) value = (value & 0x7F) | (t1_pb7 ? 0x80 : 0x00);
+        if(side_effects) clearFlags(CB1_FLAG | CB2_FLAG);
+        return value;
+    }
+    case ORA:
+        if(side_effects) clearFlags(CA1_FLAG | CA2_FLAG);
+        return (ora & ddra) | (port_a_input & ~ddra);
+    case ORA_NO_HANDSHAKE:
+        return (ora & ddra) | (port_a_input & ~ddra);
+    case DDRB:
+        return ddrb;
+    case DDRA:
+        return ddra;
+    case T1C_L:
+        if(side_effects) clearFlags(TIMER1_FLAG);
+        return timer1Counter() & 0xFF;
+    case T1C_H:
+        return timer1Counter() >> 8;
+    case T1L_L:
+        return t1_latch & 0xFF;
+    case T1L_H:
+        return t1_latch >> 8;
+    case T2C_L:
+        if(side_effects) clearFlags(TIMER2_FLAG);
+        return timer2Counter() & 0xFF;
+    case T2C_H:
+        return timer2Counter() >> 8;
+    case SR:
+        if(side_effects) startShift();
+        return sr;
+    case ACR:
+        return acr;
+    case PCR:
+        return pcr;
+    case IFR:
+        // Bit 7 is set if any enabled interrupt is
+        return ifr | ((ifr & ier & 0x7F) ? IRQ_FLAG : 0);
+    case IER:
+        return ier | 0x80;
+    }
+    return 0xFF;
+}
+
+uint16_t VIA::timer1Counter(){
+    // Right after a reload the counter still reads 0xFFFF
+    if(current_cycle < t1_load_cycle) return 0xFFFF;
+    uint64_t elapsed = current_cycle - t1_load_cycle;
+    if(timer1FreeRunning()){
+        // Counts N, N-1, ... 0, 0xFFFF and reloads, so the period is N + 2
+        uint64_t position = elapsed % ((uint64_t) t1_load_value + 2);
+        return position <= t1_load_value ? t1_load_value - position : 0xFFFF;
+    }
+    // In one-shot mode it just keeps counting down
+    return t1_load_value - elapsed;
+}
+
+uint16_t VIA::timer2Counter(){
+    if(acr & 0x20) return t2_load_value;
+    return t2_load_value - (current_cycle - t2_load_cycle);
+}
+
+void VIA::startTimer1(){
+    t1_load_cycle = current_cycle;
+    t1_load_value = t1_latch;
+    // PB7 goes low for as long as a one-shot runs
+    t1_pb7 = false;
+    if(t1_event_pending) scheduler -> cancel(t1_event);
+    scheduleTimer1(t1_load_cycle + t1_load_value + 1);
+}
+
+void VIA::scheduleTimer1(uint64_t deadline){
+    t1_event = scheduler -> schedule(deadline, [this, deadline](uint64_t){
+        timer1Expired(deadline);
+    });
+    t1_event_pending = true;
+}
+
+void VIA::timer1Expired(uint64_t deadline){
+    t1_event_pending = false;
+    setFlags(TIMER1_FLAG);
+    if(timer1FreeRunning()){
+        // Reload from the latches a cycle later and go again, PB7 makes a square wave
+        t1_pb7 = !t1_pb7;
+        t1_load_cycle = deadline + 1;
+        t1_load_value = t1_latch;
+        scheduleTimer1(t1_load_cycle + t1_load_value + 1);
+    }else{
+        t1_pb7 = true;
+    }
+}
+
+void VIA::startShift(){
+    clearFlags(SHIFT_FLAG);
+    if(shift_event_pending) scheduler -> cancel(shift_event);
+    shift_event_pending = false;
+
+    // One bit per CB1 clock. Under T2, CB1 toggles every time T2 counts its low latch down,
+    // under the system clock it toggles every cycle. Modes 0, 3 and 7 never finish on their own,
+    // and mode 4 shifts out forever without interrupting
+    uint8_t mode = (acr >> 2) & 0x07;
+    uint64_t bit_length;
+    switch(mode){
+    case 1:
+    case 5:
+        bit_length = 2 * ((uint64_t) t2_latch_low + 2);
+        break;
+    case 2:
+    case 6:
+        bit_length = 2;
+        break;
+    default:
+        return;
+    }
+    bool shift_in = mode < 4;
+    shift_event = scheduler -> schedule(current_cycle + 8 * bit_length, [this, shift_in](uint64_t){
+        shift_event_pending = false;
+        // CB2 floats high, so ones are shifted in. Shifting out rotates the register back to where it was
+        if(shift_in) sr = 0xFF;
+        setFlags(SHIFT_FLAG);
+    });
+    shift_event_pending = true;
+}
+
+void VIA::setFlags(uint8_t flags){
+    ifr |= flags;
+    updateIRQ();
+}
+
+void VIA::clearFlags(uint8_t flags){
+    ifr &= ~flags;
+    updateIRQ();
+}
+
+void VIA::updateIRQ(){
+    interrupt_controller -> setIRQ(irq_line, ifr & ier & 0x7F);
+}
@@ -0,0 +1,234 @@
+#ifndef VIA_H
+#define VIA_H
+
+#include <atomic>
+
+#include "eventscheduler.h"
+#include "interruptcontroller.h"
+#include "memorymappeddevice.h"
+
+/**
+ * A 6522 Versatile Interface Adapter: two 8-bit ports, two 16-bit timers and a shift register
+ *
+ * The timers don't count down every cycle. Their counters are worked out from the cycle they were
+ * last loaded on when they're read, and their expiry is an event on the scheduler, so a timer
+ * running in the background costs nothing until it fires
+ *
+ * Not modelled: the CA1/CA2/CB1/CB2 handshake lines (their interrupt flags can be cleared but are
+ * never set), input latching, T2 pulse counting (the counter holds) and the CB1/CB2 pins of the
+ * shift register, which always shifts in ones
+ */
+class VIA : public MemoryMappedDevice{
+public:
+    /**
+     * The registers, relative to the base address
+     */
+    enum Register{
+        ORB = 0x0,
+        ORA = 0x1,
+        DDRB = 0x2,
+        DDRA = 0x3,
+        T1C_L = 0x4,
+        T1C_H = 0x5,
+        T1L_L = 0x6,
+        T1L_H = 0x7,
+        T2C_L = 0x8,
+        T2C_H = 0x9,
+        SR = 0xA,
+        ACR = 0xB,
+        PCR = 0xC,
+        IFR = 0xD,
+        IER = 0xE,
+        ORA_NO_HANDSHAKE = 0xF
+    };
+
+    /**
+     * Bits of the interrupt flag and enable registers
+     */
+    enum InterruptFlag{
+        CA2_FLAG = 0x01,
+        CA1_FLAG = 0x02,
+        SHIFT_FLAG = 0x04,
+        CB2_FLAG = 0x08,
+        CB1_FLAG = 0x10,
+        TIMER2_FLAG = 0x20,
+        TIMER1_FLAG = 0x40,
+        IRQ_FLAG = 0x80
+    };
+
+    /**
+     * Number of registers, the register select lines only decode 4 bits
+     */
+    constexpr static size_t kRegisterCount = 0x10;
+
+    /**
+     * @param base_address
+     * @param scheduler Where timer and shift register events are scheduled
+     * @param interrupt_controller Where the IRQ output goes, the VIA takes a line of its own
+     */
+    VIA(uint16_t base_address, EventScheduler *scheduler, InterruptController *interrupt_controller);
+    ~VIA();
+
+    bool setValue(uint16_t address, uint8_t value) override;
+    uint8_t getValue(uint16_t address) override;
+    uint8_t peekValue(uint16_t address) override;
+    void sync(uint64_t cycle) override;
+
+    /**
+     * Set the levels driven onto the port A pins from outside, safe to call from any thread
+     *
+     * @param value
+     */
+    void setPortAInput(uint8_t value);
+
+    /**
+     * Set the levels driven onto the port B pins from outside, safe to call from any thread
+     *
+     * @param value
+     */
+    void setPortBInput(uint8_t value);
+
+private:
+    /**
+     * Read a register
+     *
+     * @param reg
+     * @param side_effects Whether to clear flags and start the shift register like a processor read would
+     * @return The value
+     */
+    uint8_t readRegister(uint8_t reg, bool side_effects);
+
+    /**
+     * The current value of the timer 1 counter
+     */
+    uint16_t timer1Counter();
+
+    /**
+     * The current value of the timer 2 counter
+     */
+    uint16_t timer2Counter();
+
+    /**
+     * Load timer 1 from its latches and start it
+     */
+    void startTimer1();
+
+    /**
+     * Schedule the next timer 1 expiry
+     *
+     * @param deadline
+     */
+    void scheduleTimer1(uint64_t deadline);
+
+    /**
+     * Timer 1 reached zero
+     *
+     * @param deadline The cycle it was due on, later expiries are timed from here so they don't drift
+     */
+    void timer1Expired(uint64_t deadline);
+
+    /**
+     * Start shifting 8 bits if the shift register mode is timed by T2 or the system clock
+     */
+    void startShift();
+
+    /**
+     * Set interrupt flags and update the IRQ line
+     *
+     * @param flags
+     */
+    void setFlags(uint8_t flags);
+
+    /**
+     * Clear interrupt flags and update the IRQ line
+     *
+     * @param flags
+     */
+    void clearFlags(uint8_t flags);
+
+    /**
+     * Drive the IRQ line from the flags and the enable bits
+     */
+    void updateIRQ();
+
+    /**
+     * Whether timer 1 reloads itself when it expires
+     */
+    bool timer1FreeRunning(){return acr & 0x40;}
+
+    EventScheduler *scheduler;
+    InterruptController *interrupt_controller;
+
+    /**
+     * Our line on the interrupt controller
+     */
+    unsigned irq_line;
+
+    /**
+     * The bus cycle we've been synced to
+     */
+    uint64_t current_cycle = 0;
+
+    uint8_t orb = 0;
+    uint8_t ora = 0;
+    uint8_t ddrb = 0;
+    uint8_t ddra = 0;
+    uint8_t acr = 0;
+    uint8_t pcr = 0;
+    uint8_t ifr = 0;
+    uint8_t ier = 0;
+    uint8_t sr = 0;
+
+    /**
+     * What's driven onto the port pins from outside, pulled up when nothing is connected
+     */
+    std::atomic<uint8_t> port_a_input = 0xFF;
+    std::atomic<uint8_t> port_b_input = 0xFF;
+
+    /**
+     * Timer 1 latches
+     */
+    uint16_t t1_latch = 0;
+
+    /**
+     * The cycle timer 1 was last loaded on, and what it was loaded with. The counter is worked out from these
+     */
+    uint64_t t1_load_cycle = 0;
+    uint16_t t1_load_value = 0;
+
+    /**
+     * The pending timer 1 expiry
+     */
+    EventScheduler::EventId t1_event = 0;
+    bool t1_event_pending = false;
+
+    /**
+     * What timer 1 drives PB7 to when ACR bit 7 is set
+     */
+    bool t1_pb7 = true;
+
+    /**
+     * Timer 2 low latch
+     */
+    uint8_t t2_latch_low = 0;
+
+    /**
+     * The cycle timer 2 was last loaded on, and what it was loaded with
+     */
+    uint64_t t2_load_cycle = 0;
+    uint16_t t2_load_value = 0;
+
+    /**
+     * The pending timer 2 expiry
+     */
+    EventScheduler::EventId t2_event = 0;
+    bool t2_event_pending = false;
+
+    /**
+     * The pending end of a shift
+     */
+    EventScheduler::EventId shift_event = 0;
+    bool shift_event_pending = false;
+};
+
+#endif // VIA_H
@@ -1,54 +1,96 @@
 #include "vram.h"
 
+#include <algorithm>
 #include <cstring>
 
-ROM::ROM(uint16_t base_address, size_t length, size_t kNumBankedMemories) : MemoryMappedDevice(base_address, (length - 1) * kNumBankedMemories),
-                                                                                kNumBankedMemories{kNumBankedMemories},
-                                                                                memorySize{length - 1}{
-    memories = new uint8_t*[kNumBankedMemories];
-    for(int bankNum = 0; bankNum < kNumBankedMemories; bankNum++){
-        memories[bankNum] = new uint8_t[memorySize];
-        memset(memories[bankNum], 0xFF, memorySize);
-    }
-
-    // Make the garbage data here at least valid
-    currentBankNumber = currentBankNumber % kNumBankedMemories;
+const uint32_t VRAM::kPalette[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF
+};
 
+VRAM::VRAM(uint16_t base_address) : MemoryMappedDevice(base_address, kRegisterSpace + FrameSnapshot::kMemorySize){
+    memset(memory, 0x00, sizeof(memory));
+    // Everything needs drawing the first time
+    std::fill(tile_generation, tile_generation + FrameSnapshot::kTileCount, generation);
+    std::fill(glyph_generation, glyph_generation + 256, generation);
 }
 
-ROM::~ROM(){
-    for(int bankNum = 0; bankNum < kNumBankedMemories; bankNum++){
-        delete[] memories[bankNum];
-    }
-    delete[] memories;
-}
+bool VRAM::setValue(uint16_t address, uint8_t value){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return false;
 
-bool ROM::setValue(uint16_t address, uint8_t value){
-    if(address == baseAddress){
-        // Relative address 0 is the bank number register
-        currentBankNumber = value;
+    if(relative_address < kRegisterSpace){
+        switch(relative_address){
+        case MODE:
+            mode = value;
+            break;
+        case FOREGROUND:
+            foreground = value & 0x0F;
+            break;
+        case BACKGROUND:
+            background = value & 0x0F;
+            break;
+        default:
+            return false;
+        }
+        screen_generation = generation;
         return true;
-    }else{
-        // Everything else is a VRAM address
-        uint16_t relative_address = address - (baseAddress + 1);
-        if(relative_address < memorySize){
-            memories[currentBankNumber][relative_address] = value;
-            return true;
+    }
+
+    size_t offset = relative_address - kRegisterSpace;
+    memory[offset] = value;
+
+    if(mode & CHARACTER_MODE){
+        if(offset < FrameSnapshot::kNameTableOffset + FrameSnapshot::kTileCount){
+            markTile(offset - FrameSnapshot::kNameTableOffset);
+        }else if(offset >= FrameSnapshot::kAttributeTableOffset && offset < FrameSnapshot::kAttributeTableOffset + FrameSnapshot::kTileCount){
+            markTile(offset - FrameSnapshot::kAttributeTableOffset);
+        }else if(offset >= FrameSnapshot::kPatternTableOffset && offset < FrameSnapshot::kPatternTableOffset + 256 * 8){
+            glyph_generation[(offset - FrameSnapshot::kPatternTableOffset) / 8] = generation;
         }
-        return false;
+    }else{
+        // 32 bytes per line, 8 lines per tile
+        size_t line = offset / FrameSnapshot::kColumns;
+        size_t column = offset % FrameSnapshot::kColumns;
+        markTile((line / FrameSnapshot::kTileSize) * FrameSnapshot::kColumns + column);
+    }
+    return true;
+}
+
+uint8_t VRAM::getValue(uint16_t address){
+    // Calculate the relative address
+    size_t relative_address = address - this -> base_address;
+    if(relative_address >= this -> address_space_length) return 0xFF;
+
+    switch(relative_address){
+    case MODE:
+        return mode;
+    case FOREGROUND:
+        return foreground;
+    case BACKGROUND:
+        return background;
     }
+    if(relative_address < kRegisterSpace) return 0xFF;
+    return memory[relative_address - kRegisterSpace];
 }
 
-uint8_t ROM::getValue(uint16_t address){
-    // Relative address 0 is the bank number register
-    if(address == baseAddress){
-        return currentBankNumber;
-    } else {
-        // Grab value from memory, check if it's valid and if so, return it
-        uint16_t relative_address = address - (baseAddress + 1);
-        if(relative_address < memorySize){
-            return memories[currentBankNumber][relative_address];
+void VRAM::captureFrame(FrameSnapshot &frame){
+    frame.generation = generation;
+    frame.mode = mode;
+    frame.foreground = foreground;
+    frame.background = background;
+    memcpy(frame.memory, memory, sizeof(memory));
+
+    // A cell also changes when its glyph or the whole screen does
+    for(int tile = 0; tile < FrameSnapshot::kTileCount; tile++){
+        uint64_t tile_changed = std::max(tile_generation[tile], screen_generation);
+        if(mode & CHARACTER_MODE){
+            tile_changed = std::max(tile_changed, glyph_generation[memory[FrameSnapshot::kNameTableOffset + tile]]);
         }
-        return 0xFF; // Return -1 if the address is invalid
+        frame.tile_generation[tile] = tile_changed;
     }
+
+    // Anything written from now on shows up in the next capture
+    generation++;
 }
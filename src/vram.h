@@ -1,22 +1,146 @@
 #ifndef VRAM_H
 #define VRAM_H
 
+#include <cstdint>
+
 #include "memorymappeddevice.h"
 
-class ROM : public MemoryMappedDevice
-{
+/**
+ * What the display needs from the video device, captured along with a machine snapshot
+ *
+ * Every capture gets a new generation number, and each tile remembers the generation it last changed
+ * in. A reader that remembers the last generation it drew only needs to redraw the tiles newer than
+ * that, even if it missed some snapshots in between
+ */
+struct FrameSnapshot{
+    /**
+     * Screen size in pixels
+     */
+    constexpr static int kWidth = 256;
+    constexpr static int kHeight = 192;
+
+    /**
+     * The screen is tracked in tiles of kTileSize x kTileSize pixels, which are also the character cells
+     */
+    constexpr static int kTileSize = 8;
+    constexpr static int kColumns = kWidth / kTileSize;
+    constexpr static int kRows = kHeight / kTileSize;
+    constexpr static int kTileCount = kColumns * kRows;
+
+    /**
+     * Size of the video memory, the bitmap takes all of it
+     */
+    constexpr static size_t kMemorySize = kWidth * kHeight / 8;
+
+    /**
+     * Where the character codes and the glyphs live in character mode
+     */
+    constexpr static size_t kNameTableOffset = 0x000;
+    constexpr static size_t kAttributeTableOffset = 0x400;
+    constexpr static size_t kPatternTableOffset = 0x800;
+
+    uint64_t generation = 0;
+
+    uint8_t mode = 0;
+    uint8_t foreground = 0;
+    uint8_t background = 0;
+
+    /**
+     * The generation each tile last changed in
+     */
+    uint64_t tile_generation[kTileCount];
+
+    uint8_t memory[kMemorySize];
+};
+
+/**
+ * A 256x192 framebuffer with a bitmapped and a character mode
+ *
+ * In bitmapped mode each byte is 8 pixels, most significant bit on the left, 32 bytes per line. In
+ * character mode the screen is 32x24 cells of 8x8 pixels, the name table holds a character code per
+ * cell and the pattern table 8 bytes of glyph per character, laid out like the bitmap. There is no
+ * built-in font, programs load their own glyphs. With ATTRIBUTE_COLOURS set each cell also has an
+ * attribute byte picking its colours, foreground in the low nibble and background in the high one,
+ * otherwise the whole screen uses the foreground and background registers
+ *
+ * Writes mark the tiles they affect as dirty, so the display only redraws what changed
+ */
+class VRAM : public MemoryMappedDevice{
 public:
-    ROM(uint16_t base_address, size_t length, size_t kNumBankedMemories);
-    ~ROM();
+    /**
+     * The registers, relative to the base address. The video memory starts at kRegisterSpace
+     */
+    enum Register{
+        MODE = 0x0,
+        FOREGROUND = 0x1,
+        BACKGROUND = 0x2
+    };
+
+    /**
+     * Bits of the mode register
+     */
+    enum ModeBit{
+        CHARACTER_MODE = 0x01,
+        ATTRIBUTE_COLOURS = 0x02
+    };
+
+    /**
+     * Address space taken by the registers, the video memory follows
+     */
+    constexpr static size_t kRegisterSpace = 0x100;
+
+    /**
+     * 16 colours the foreground and background registers pick from, as 0xRRGGBB
+     */
+    static const uint32_t kPalette[16];
+
+    VRAM(uint16_t base_address);
 
     bool setValue(uint16_t address, uint8_t value) override;
     uint8_t getValue(uint16_t address) override;
 
+    /**
+     * Copy the display state into a snapshot and start a new generation
+     *
+     * Must be called from the thread running the CPU, or while the processor isn't running
+     *
+     * @param frame
+     */
+    void captureFrame(FrameSnapshot &frame);
+
 private:
-    uint8_t** memories;
-    size_t currentBankNumber;
-    const size_t kNumBankedMemories;
-    const size_t memorySize;
+    /**
+     * Mark a tile as changed in the current generation
+     *
+     * @param tile
+     */
+    void markTile(int tile){tile_generation[tile] = generation;}
+
+    uint8_t mode = 0;
+    uint8_t foreground = 15;
+    uint8_t background = 0;
+
+    uint8_t memory[FrameSnapshot::kMemorySize];
+
+    /**
+     * The current generation, bumped on every capture
+     */
+    uint64_t generation = 1;
+
+    /**
+     * The generation each tile last changed in, by a write to its pixels or its character code
+     */
+    uint64_t tile_generation[FrameSnapshot::kTileCount];
+
+    /**
+     * The generation each glyph last changed in, every cell showing it changes with it
+     */
+    uint64_t glyph_generation[256];
+
+    /**
+     * The generation the whole screen last changed in, e.g. because the colours did
+     */
+    uint64_t screen_generation = 1;
 };
 
 #endif // VRAM_H
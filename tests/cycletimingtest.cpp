@@ -0,0 +1,286 @@
+/**
+ * Checks the processor's cycle counts against the NMOS 6502 timing tables, and that Run() and
+ * RunCycleStepped() end up in the same place
+ *
+ * Every documented opcode is run on its own from a flat 64K memory, once with its operand inside
+ * one page and once with the indexed address crossing into the next. Returns non-zero if anything
+ * doesn't match, so it can be run by ctest
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "mos6502.h"
+
+namespace {
+
+/**
+ * Base cycles of every documented opcode, 0 for undocumented ones. Page crossings and taken branches
+ * aren't counted here
+ */
+const uint8_t kBaseCycles[256] = {
+//  0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F
+    7, 6, 0, 0, 0, 3, 5, 0, 3, 2, 2, 0, 0, 4, 6, 0, // 0
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 1
+    6, 6, 0, 0, 3, 3, 5, 0, 4, 2, 2, 0, 4, 4, 6, 0, // 2
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 3
+    6, 6, 0, 0, 0, 3, 5, 0, 3, 2, 2, 0, 3, 4, 6, 0, // 4
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 5
+    6, 6, 0, 0, 0, 3, 5, 0, 4, 2, 2, 0, 5, 4, 6, 0, // 6
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // 7
+    0, 6, 0, 0, 3, 3, 3, 0, 2, 0, 2, 0, 4, 4, 4, 0, // 8
+    2, 6, 0, 0, 4, 4, 4, 0, 2, 5, 2, 0, 0, 5, 0, 0, // 9
+    2, 6, 2, 0, 3, 3, 3, 0, 2, 2, 2, 0, 4, 4, 4, 0, // A
+    2, 5, 0, 0, 4, 4, 4, 0, 2, 4, 2, 0, 4, 4, 4, 0, // B
+    2, 6, 0, 0, 3, 3, 5, 0, 2, 2, 2, 0, 4, 4, 6, 0, // C
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // D
+    2, 6, 0, 0, 3, 3, 5, 0, 2, 2, 2, 0, 4, 4, 6, 0, // E
+    2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0, // F
+};
+
+/**
+ * Whether an opcode takes a cycle more when its indexed address crosses a page. Only reads do,
+ * stores and read-modify-writes always take the extra cycle
+ */
+bool hasPageCrossingCycle(uint8_t opcode){
+    switch(opcode){
+    case 0x11: case 0x19: case 0x1D: // ORA
+    case 0x31: case 0x39: case 0x3D: // AND
+    case 0x51: case 0x59: case 0x5D: // EOR
+    case 0x71: case 0x79: case 0x7D: // ADC
+    case 0xB1: case 0xB9: case 0xBD: // LDA
+    case 0xBE:                       // LDX
+    case 0xBC:                       // LDY
+    case 0xD1: case 0xD9: case 0xDD: // CMP
+    case 0xF1: case 0xF9: case 0xFD: // SBC
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Which status flag a branch tests (the high three bits of the opcode pick it) and whether it's
+ * taken when the flag is set
+ */
+bool isBranch(uint8_t opcode){
+    return (opcode & 0x1F) == 0x10;
+}
+
+uint8_t branchFlag(uint8_t opcode){
+    const uint8_t flags[4] = {0x80, 0x40, 0x01, 0x02}; // N, V, C, Z
+    return flags[opcode >> 6];
+}
+
+bool branchTakenWhenSet(uint8_t opcode){
+    return opcode & 0x20;
+}
+
+uint8_t memory[65536];
+
+/**
+ * Bus accesses made since the last reset of the count
+ */
+uint64_t bus_accesses;
+
+/**
+ * The first bus accesses since the last reset of the count, in order, for checking where an
+ * instruction's dummy accesses go
+ */
+struct BusAccess {
+    uint16_t address;
+    bool write;
+};
+
+const int kBusLogLength = 8;
+BusAccess bus_log[kBusLogLength];
+
+void logAccess(uint16_t address, bool write){
+    if(bus_accesses < kBusLogLength) bus_log[bus_accesses] = {address, write};
+    bus_accesses++;
+}
+
+uint8_t busRead(uint16_t address){
+    logAccess(address, false);
+    return memory[address];
+}
+
+void busWrite(uint16_t address, uint8_t value){
+    logAccess(address, true);
+    memory[address] = value;
+}
+
+/**
+ * Where the instruction under test is placed
+ */
+const uint16_t kCodeAddress = 0x0200;
+
+/**
+ * Where every addressing mode points, with the index registers at 0
+ */
+const uint16_t kDataAddress = 0x3000;
+
+/**
+ * What the index registers are set to for the page crossing runs
+ */
+const uint8_t kCrossingIndex = 0x10;
+
+/**
+ * Set up memory for one instruction, every addressing mode ends up at kDataAddress, or crosses out
+ * of its page once indexed when crossing is set. For branches, crossing places the instruction so a
+ * taken branch lands on the next page
+ *
+ * @param opcode
+ * @param crossing
+ * @return Where the instruction is
+ */
+uint16_t setUpInstruction(uint8_t opcode, bool crossing){
+    memset(memory, 0, sizeof(memory));
+    uint16_t address = kCodeAddress;
+    uint8_t low = crossing ? 0xF8 : 0x00;
+    if(isBranch(opcode)){
+        // Branching forward from the end of a page goes over into the next one
+        address = crossing ? kCodeAddress + 0xFC : kCodeAddress;
+        memory[address] = opcode;
+        memory[address + 1] = 0x02;
+    }else{
+        memory[address] = opcode;
+        memory[address + 1] = low;
+        memory[address + 2] = kDataAddress >> 8;
+    }
+    // Pointers for the indirect modes, in the zero page where the operand byte points
+    memory[low] = low;
+    memory[low + 1] = kDataAddress >> 8;
+    memory[0xFFFC] = address & 0xFF;
+    memory[0xFFFD] = address >> 8;
+    return address;
+}
+
+/**
+ * Run one instruction
+ *
+ * @param cpu
+ * @param opcode
+ * @param crossing Whether the index registers push the address over a page
+ * @param flags The status register to start with
+ * @param cycle_stepped Whether to use RunCycleStepped()
+ * @return The cycles it took
+ */
+uint64_t runInstruction(mos6502 &cpu, uint8_t opcode, bool crossing, uint8_t flags, bool cycle_stepped){
+    setUpInstruction(opcode, crossing);
+    cpu.SetResetA(0x5A);
+    cpu.SetResetX(crossing ? kCrossingIndex : 0);
+    cpu.SetResetY(crossing ? kCrossingIndex : 0);
+    cpu.SetResetS(0xFD);
+    cpu.SetResetP(flags);
+    cpu.Reset();
+    bus_accesses = 0;
+    uint64_t cycles = 0;
+    if(cycle_stepped){
+        cpu.RunCycleStepped(1, cycles, mos6502::INST_COUNT);
+    }else{
+        cpu.Run(1, cycles, mos6502::INST_COUNT);
+    }
+    return cycles;
+}
+
+int failures = 0;
+
+void expectCycles(uint8_t opcode, const char *what, uint64_t cycles, uint64_t expected){
+    if(cycles == expected) return;
+    printf("%02X %s: %llu cycles, expected %llu\n", opcode, what, (unsigned long long) cycles, (unsigned long long) expected);
+    failures++;
+}
+
+/**
+ * The base, page crossing and branch timings of one opcode
+ */
+void checkTiming(mos6502 &cpu, uint8_t opcode){
+    uint8_t base = kBaseCycles[opcode];
+    if(isBranch(opcode)){
+        uint8_t flag = branchFlag(opcode);
+        uint8_t not_taken = branchTakenWhenSet(opcode) ? 0x20 : 0x20 | flag;
+        uint8_t taken = branchTakenWhenSet(opcode) ? 0x20 | flag : 0x20;
+        expectCycles(opcode, "not taken", runInstruction(cpu, opcode, false, not_taken, false), base);
+        expectCycles(opcode, "taken", runInstruction(cpu, opcode, false, taken, false), base + 1);
+        expectCycles(opcode, "taken across a page", runInstruction(cpu, opcode, true, taken, false), base + 2);
+        return;
+    }
+    expectCycles(opcode, "base", runInstruction(cpu, opcode, false, 0x20, false), base);
+    expectCycles(opcode, "across a page", runInstruction(cpu, opcode, true, 0x20, false), base + (hasPageCrossingCycle(opcode) ? 1 : 0));
+}
+
+/**
+ * Run() and RunCycleStepped() leave the processor and memory the same and take the same cycles,
+ * and the cycle stepped one makes exactly one bus access per cycle
+ */
+uint8_t run_memory[65536];
+
+void checkRunModesAgree(mos6502 &cpu, uint8_t opcode){
+    for(int crossing = 0; crossing < 2; crossing++){
+        for(uint8_t flags : {0x20, 0xE3}){
+            uint64_t cycles = runInstruction(cpu, opcode, crossing, flags, false);
+            uint8_t registers[6] = {cpu.GetA(), cpu.GetX(), cpu.GetY(), cpu.GetS(), cpu.GetP(), (uint8_t) cpu.IsHalted()};
+            uint16_t pc = cpu.GetPC();
+            memcpy(run_memory, memory, sizeof(memory));
+
+            uint64_t stepped_cycles = runInstruction(cpu, opcode, crossing, flags, true);
+            uint8_t stepped_registers[6] = {cpu.GetA(), cpu.GetX(), cpu.GetY(), cpu.GetS(), cpu.GetP(), (uint8_t) cpu.IsHalted()};
+            if(stepped_cycles != cycles || bus_accesses != stepped_cycles || cpu.GetPC() != pc
+               || memcmp(registers, stepped_registers, sizeof(registers)) != 0 || memcmp(run_memory, memory, sizeof(memory)) != 0){
+                printf("%02X: Run() and RunCycleStepped() differ (flags %02X%s)\n", opcode, flags, crossing ? ", across a page" : "");
+                failures++;
+            }
+        }
+    }
+}
+
+/**
+ * The cycle stepped JSR makes its accesses in the NMOS order: the opcode and the low byte of the
+ * target, a dummy read of the stack, the return address pushed high byte first, and the high byte
+ * of the target last
+ */
+void checkJsrBusOrder(mos6502 &cpu){
+    const uint8_t opcode = 0x20;
+    uint16_t address = setUpInstruction(opcode, false);
+    runInstruction(cpu, opcode, false, 0x20, true);
+    const BusAccess expected[6] = {
+        {address, false},
+        {(uint16_t) (address + 1), false},
+        {0x01FD, false},
+        {0x01FD, true},
+        {0x01FC, true},
+        {(uint16_t) (address + 2), false},
+    };
+    bool matches = bus_accesses == 6;
+    for(int i = 0; matches && i < 6; i++){
+        matches = bus_log[i].address == expected[i].address && bus_log[i].write == expected[i].write;
+    }
+    if(!matches){
+        printf("20: JSR bus accesses out of order\n");
+        failures++;
+    }
+    if(memory[0x01FD] != ((address + 2) >> 8) || memory[0x01FC] != ((address + 2) & 0xFF) || cpu.GetPC() != kDataAddress){
+        printf("20: JSR pushed the wrong return address or went to the wrong place\n");
+        failures++;
+    }
+}
+
+}
+
+int main(){
+    mos6502 cpu(busRead, busWrite);
+    for(int opcode = 0; opcode < 256; opcode++){
+        if(kBaseCycles[opcode] == 0) continue;
+        checkTiming(cpu, opcode);
+        checkRunModesAgree(cpu, opcode);
+    }
+    checkJsrBusOrder(cpu);
+    if(failures != 0){
+        printf("%d cycle timing checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("All cycle timings match\n");
+    return EXIT_SUCCESS;
+}